@@ -0,0 +1,176 @@
+# Compiles SMVTuner tuning files into the firmware's table header.
+#
+#   python TuneCompiler.py [--ve tuningve.smv] [--sa tuningsa.smv] [-o ../ecu/tunedata.h]
+#
+# The .smv files are the pickles saved by the tuner. If one is missing,
+# the default table from TuneModels is used, the same as the tuner does.
+# The output is a header of constexpr axes, segment reciprocals and
+# narrow table data in the format tuning.h builds its tables from,
+# along with a hash of the tune so the firmware can report which one it has.
+
+import argparse
+import os
+import pickle
+import sys
+from TuneModels import ModelVE, ModelSA
+
+DEFAULT_OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "ecu", "tunedata.h")
+
+
+class TuneError(Exception):
+    pass
+
+
+class TableFormat:
+    def __init__(self, name, ctype, scale, low, high, default):
+        self.name = name        # suffix used for the C names, like VE in dataVE
+        self.ctype = ctype      # C type the data is stored as
+        self.scale = scale      # real value = raw * scale
+        self.low = low          # smallest raw value the C type can hold
+        self.high = high        # largest raw value the C type can hold
+        self.default = default  # value the table gives below its x axis
+
+
+VE_FORMAT = TableFormat("VE", "uint8_t", 1, 0, 255, -1)
+SA_FORMAT = TableFormat("SA", "int16_t", 0.1, -32768, 32767, 5.0)
+
+
+class TuneUnpickler(pickle.Unpickler):
+    # Tunes saved before the models moved to TuneModels name their classes
+    # as TablePrototype.ModelVE and so on. TablePrototype imports PyQt5,
+    # so those are looked up in TuneModels instead.
+    def find_class(self, module, name):
+        if module == "TablePrototype":
+            module = "TuneModels"
+        return super().find_class(module, name)
+
+
+def loadTable(path, model):
+    try:
+        with open(path, "rb") as f:
+            return TuneUnpickler(f).load()
+    except FileNotFoundError:
+        print("No existing tuning found at %s, using the default table" % path)
+        return model()
+
+
+def formatNumber(value):
+    return "%.9g" % value
+
+
+def checkAxis(name, axis):
+    if len(axis) < 2:
+        raise TuneError("%s needs at least two values" % name)
+    for i in range(1, len(axis)):
+        if not axis[i - 1] < axis[i]:
+            raise TuneError("%s must be strictly increasing, but %s comes after %s" % (name, formatNumber(axis[i]), formatNumber(axis[i - 1])))
+
+
+def rawData(table, fmt):
+    rows = []
+    for y, row in enumerate(table.data):
+        if len(row) != len(table.xaxis):
+            raise TuneError("row %d of the %s table has %d values, but the x axis has %d" % (y, fmt.name, len(row), len(table.xaxis)))
+        raws = []
+        for x, value in enumerate(row):
+            raw = float(value) / fmt.scale
+            rounded = int(round(raw))
+            if abs(raw - rounded) > 1e-6:
+                raise TuneError("%s[%d][%d] = %s is not a multiple of %s" % (fmt.name, y, x, value, formatNumber(fmt.scale)))
+            if rounded < fmt.low or rounded > fmt.high:
+                raise TuneError("%s[%d][%d] = %s does not fit in %s" % (fmt.name, y, x, value, fmt.ctype))
+            raws.append(rounded)
+        rows.append(raws)
+    if len(rows) != len(table.yaxis):
+        raise TuneError("the %s table has %d rows, but the y axis has %d" % (fmt.name, len(rows), len(table.yaxis)))
+    return rows
+
+
+def reciprocals(axis):
+    return [1.0 / (float(axis[i + 1]) - float(axis[i])) for i in range(len(axis) - 1)]
+
+
+def emitArray(ctype, name, values):
+    return "constexpr %s %s[] = {%s};" % (ctype, name, ", ".join(formatNumber(float(v)) for v in values))
+
+
+def emitTable(table, fmt):
+    checkAxis("x axis of %s" % fmt.name, [float(v) for v in table.xaxis])
+    checkAxis("y axis of %s" % fmt.name, [float(v) for v in table.yaxis])
+    rows = rawData(table, fmt)
+
+    lines = []
+    lines.append(emitArray("float", "yAxis" + fmt.name, table.yaxis))
+    lines.append(emitArray("float", "xAxis" + fmt.name, table.xaxis))
+    lines.append(emitArray("float", "yRecip" + fmt.name, reciprocals(table.yaxis)))
+    lines.append(emitArray("float", "xRecip" + fmt.name, reciprocals(table.xaxis)))
+    lines.append("const %s data%s[][%d] = {" % (fmt.ctype, fmt.name, len(table.xaxis)))
+    lines.append(",\n".join("   {" + ", ".join(str(v) for v in row) + "}" for row in rows))
+    lines.append("};")
+    lines.append("const float scale%s = %s;" % (fmt.name, formatNumber(fmt.scale)))
+    lines.append("const float default%s = %s;" % (fmt.name, formatNumber(fmt.default)))
+    lines.extend(emitChecks(fmt.name))
+    return "\n".join(lines)
+
+
+def emitLength(name):
+    return "sizeof(%s) / sizeof(%s[0])" % (name, name)
+
+
+def emitChecks(name):
+    # The rows are counted from the data itself, so these still hold
+    # the header together if a row, an axis value or a reciprocal is
+    # added or dropped by hand.
+    checks = [
+        ("data%s" % name, "yAxis%s" % name, "", "data%s needs one row per y axis value" % name),
+        ("data%s[0]" % name, "xAxis%s" % name, "", "data%s needs one column per x axis value" % name),
+        ("yRecip%s" % name, "yAxis%s" % name, " - 1", "yRecip%s needs one value per y axis segment" % name),
+        ("xRecip%s" % name, "xAxis%s" % name, " - 1", "xRecip%s needs one value per x axis segment" % name),
+    ]
+    return ["static_assert(%s == %s%s, \"%s\");" % (emitLength(array), emitLength(axis), less, message)
+            for array, axis, less, message in checks]
+
+
+def fnv1a(text):
+    value = 0x811c9dc5
+    for byte in text.encode("ascii"):
+        value = ((value ^ byte) * 0x01000193) & 0xffffffff
+    return value
+
+
+def compileTune(vetable, satable, sources):
+    body = emitTable(vetable, VE_FORMAT) + "\n\n" + emitTable(satable, SA_FORMAT) + "\n"
+
+    header = []
+    header.append("//tunedata.h")
+    header.append("//Generated by SMVTuner/TuneCompiler.py from %s." % " and ".join(sources))
+    header.append("//Do not edit this file by hand, change the tune and run TuneCompiler.py again.")
+    header.append("#ifndef TUNEDATA_H")
+    header.append("#define TUNEDATA_H")
+    header.append("")
+    header.append("#include <stdint.h>")
+    header.append("")
+    header.append("/*  This is a hash of the table data below,")
+    header.append("   so you can tell which tune the firmware was built with. */")
+    header.append("#define TUNE_HASH 0x%08xUL" % fnv1a(body))
+    header.append("")
+    return "\n".join(header) + "\n" + body + "\n#endif\n"
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Compile SMVTuner tuning files into firmware table data.")
+    parser.add_argument("--ve", default="tuningve.smv", help="VE tuning file")
+    parser.add_argument("--sa", default="tuningsa.smv", help="SA tuning file")
+    parser.add_argument("-o", default=DEFAULT_OUTPUT, help="header to write")
+    args = parser.parse_args()
+
+    try:
+        output = compileTune(loadTable(args.ve, ModelVE), loadTable(args.sa, ModelSA),
+                             [os.path.basename(args.ve), os.path.basename(args.sa)])
+    except TuneError as e:
+        print("Tune not compiled: %s" % e)
+        sys.exit(1)
+
+    with open(args.o, "w") as f:
+        f.write(output)
+    print("wrote %s" % os.path.normpath(args.o))
@@ -0,0 +1,63 @@
+//densegrid.cpp
+#include "densegrid.h"
+#include <math.h>
+
+/* This is a helper function used to fill in one point of a grid. */
+static void denseBuildPoint(densegrid_t *grid, int x, int y) {
+   grid->data[y * grid->width + x] = tableLookup(grid->src, grid->x0 + x * grid->xStep, grid->y0 + y * grid->yStep);
+}
+
+/* This is a helper function used to find the grid points on one axis
+   that lie between two table axis values. One extra point is taken on
+   each side so that rounding can never leave one out. */
+static void denseSpan(float from, float to, float start, float recip, int size, int *lo, int *hi) {
+   *lo = (int)floorf((from - start) * recip) - 1;
+   *hi = (int)ceilf((to - start) * recip) + 1;
+   if (*lo < 0) *lo = 0;
+   if (*hi > size - 1) *hi = size - 1;
+}
+
+/*    This is a function used to set up a grid over a table and fill it in. */
+void denseInit(densegrid_t *grid, table_t *src, int width, int height, float *data) {
+   grid->src = src;
+   grid->data = data;
+   grid->width = width;
+   grid->height = height;
+   grid->x0 = src->xVals[0];
+   grid->y0 = src->yVals[0];
+   grid->xStep = (src->xVals[src->width - 1] - grid->x0) / (width - 1);
+   grid->yStep = (src->yVals[src->height - 1] - grid->y0) / (height - 1);
+   grid->xRecip = 1 / grid->xStep;
+   grid->yRecip = 1 / grid->yStep;
+   denseBuild(grid);
+}
+
+/*    This is a function used to fill in every point of a grid again. */
+void denseBuild(densegrid_t *grid) {
+   int x, y;
+
+   for (y = 0; y < grid->height; y++) {
+      for (x = 0; x < grid->width; x++) {
+         denseBuildPoint(grid, x, y);
+      }
+   }
+}
+
+/*    This is a function used to fill in the grid points that depend on one table value. */
+void denseRefresh(densegrid_t *grid, int x, int y) {
+   const table_t *src = grid->src;
+   int xLo, xHi, yLo, yHi;
+   int gx, gy;
+
+   // a table value only reaches as far as the axis values on either side of it
+   denseSpan(src->xVals[x > 0 ? x - 1 : 0], src->xVals[x < src->width - 1 ? x + 1 : x],
+             grid->x0, grid->xRecip, grid->width, &xLo, &xHi);
+   denseSpan(src->yVals[y > 0 ? y - 1 : 0], src->yVals[y < src->height - 1 ? y + 1 : y],
+             grid->y0, grid->yRecip, grid->height, &yLo, &yHi);
+
+   for (gy = yLo; gy <= yHi; gy++) {
+      for (gx = xLo; gx <= xHi; gx++) {
+         denseBuildPoint(grid, gx, gy);
+      }
+   }
+}
@@ -0,0 +1,72 @@
+//densegrid.h
+#ifndef DENSEGRID_H
+#define DENSEGRID_H
+
+#include "table.h"
+
+/*  This is a dense grid resampled from a table_t.
+   Its points are evenly spaced from the first to the last value
+   of each of the table's axes, so finding the cell around an input
+   is a subtract, a multiply and a cast instead of a search,
+   and a lookup takes the same time wherever the engine is.
+   Unlike UniformTable its size and spacing are picked at runtime.
+   The trade off is memory, 4 bytes per point, and the grid only
+   follows the table exactly at its own points, so a table whose axis
+   is bunched up somewhere needs enough points to resolve it there.
+   The data is allocated by the caller, width * height floats. */
+typedef struct densegrid_t {
+   table_t *src;
+   float *data;
+   int width;
+   int height;
+   float x0;
+   float y0;
+   float xStep;
+   float yStep;
+   float xRecip;     // 1 / xStep
+   float yRecip;     // 1 / yStep
+} densegrid_t;
+
+/*    This is a function used to set up a grid over a table and fill it in. */
+void denseInit(densegrid_t *grid, table_t *src, int width, int height, float *data);
+
+/*    This is a function used to fill in every point of a grid again. */
+void denseBuild(densegrid_t *grid);
+
+/*    This is a function used to fill in just the grid points that depend on
+   the source table's value at x, y, after that value was changed. */
+void denseRefresh(densegrid_t *grid, int x, int y);
+
+/*    This is the main function used to access grid data.
+   It gives the table's default value below the start of the x axis
+   and clamps everywhere else, the same as tableLookup. */
+inline float denseLookup(const densegrid_t *grid, float x, float y) {
+   float xPos, yPos, xWeight, yWeight;
+   float top, bottom;
+   const float *cell;
+   int xIndex, yIndex;
+
+   if (x < grid->x0) {
+      return grid->src->defaultVal;
+   }
+
+   xPos = (x - grid->x0) * grid->xRecip;
+   yPos = (y - grid->y0) * grid->yRecip;
+   xPos = xPos < grid->width - 1 ? xPos : grid->width - 1;
+   yPos = yPos < grid->height - 1 ? yPos : grid->height - 1;
+   yPos = yPos > 0 ? yPos : 0;
+
+   xIndex = (int)xPos;
+   yIndex = (int)yPos;
+   xIndex = xIndex < grid->width - 2 ? xIndex : grid->width - 2;
+   yIndex = yIndex < grid->height - 2 ? yIndex : grid->height - 2;
+   xWeight = xPos - xIndex;
+   yWeight = yPos - yIndex;
+
+   cell = grid->data + yIndex * grid->width + xIndex;
+   top = cell[0] + (cell[1] - cell[0]) * xWeight;
+   bottom = cell[grid->width] + (cell[grid->width + 1] - cell[grid->width]) * xWeight;
+   return top + (bottom - top) * yWeight;
+}
+
+#endif
@@ -2,36 +2,59 @@
 
 #include <DueTimer.h>
 #include "table.h"
+#include "tuner.h"
 #include "tuning.h"
+#include "scheduler.h"
+#include "latency.h"
+#include "observer.h"
+#include "units.h"
+#include "timebase.h"
 
 #define TRUE 1
 #define FALSE 0
 
 #define SERIAL_INTERFACE Serial
+#define PRINT_LINE_ROOM 72   // longest line of telemetry, so a line only goes out when it fits without waiting
 
 #define KILL_SWITCH_IN 13
 
-#define INTERRUPT_LATENCY_US 127
+#define ARM_LATENCY ticksMicros(1)   // starting guess for how long it takes to start a pulse
 
-#define TAC_IN  2  // pin used for tachometer
+#define TAC_IN  2  // pin used for tachometer, which has to be TICK_TIMER's TIOA line (TIOA0)
 #define MAP_IN  A3  // pin used for manifold air pressure
 
-#define FUEL_OUT 4  // pin used for fuel injection
-#define SPARK_OUT 6  // pin used for spark
+#define FUEL_OUT 4  // pin used for fuel injection, which has to be FUEL_TIMER's TIOB line (TIOB6)
+#define SPARK_OUT 3  // pin used for spark, which has to be SPARK_TIMER's TIOA line (TIOA7). It was pin 6, see README.md for the wiring
 
-#define FUEL_TIMER Timer0
-#define SPARK_TIMER Timer1
+#define FUEL_TIMER_NUMBER 6   // these drive their pins themselves, so the pulses need no ISR on the edges
+#define SPARK_TIMER_NUMBER 7
+#define FUEL_TIMER Timer6
+#define SPARK_TIMER Timer7
+#define FUEL_CHANNEL DueTimerChannel<FUEL_TIMER_NUMBER>
+#define SPARK_CHANNEL DueTimerChannel<SPARK_TIMER_NUMBER>
 
-#define DWELLTIME 3500 // spark coil dwell time in us
+// interrupt priorities, 0 goes first and can interrupt the rest (there are 16 levels)
+#define TACH_PRIORITY 0    // tooth times feed everything, so nothing may hold up the tach
+#define SPARK_PRIORITY 1
+#define FUEL_PRIORITY 2
+#define OTHER_PRIORITY 8   // kill switch, serial and anything else
+
+#define DWELLTIME ticksMicros(3500) // spark coil dwell time
+
+#define SPARK_TRIM_MAX angleDegrees(5)   // furthest the spark angle feedback can move the spark
 
 #define ACTIVE_RPM 300     // don't do anything below this rpm
 
+// cycles whose rpm and map fall in the same steps as the last cycle reuse its results
+#define MEMO_RPM_STEP 25.0f   // rpm
+#define MEMO_MAP_STEP 0.5f    // kPa
+
 #define NUM_TEETH 11
-#define CALIB_ANGLE 175.0f            // angle of the first tooth after the missing one
-#define ANGLE_PER_TOOTH 30.0f   // angle distance between teeth
-#define TDC 360.0f      // crankshaft top dead center in degrees
+#define CALIB_ANGLE angleDegrees(175)            // angle of the first tooth after the missing one
+#define ANGLE_PER_TOOTH angleDegrees(30)   // angle distance between teeth
+#define TDC angleDegrees(360)      // crankshaft top dead center
 
-#define DEGREES_PER_CYCLE 360.0f
+#define DEGREES_PER_CYCLE angleDegrees(360)
 
 #define ENGINE_DISPLACEMENT 49.0f  // volume of the engine in cubic centimeters
 #define AMBIENT_TEMP 298.0f        // ambient temperature in kelvin
@@ -39,59 +62,101 @@
 #define AIR_FUEL_RATIO 14.7f      // air to fuel ratio for octane (MAY NEED REVISION)
 #define MASS_FLOW_RATE  0.0006f         // fuel injection flow rate in kg/s
 
-#define CALIBRATION_FACTOR 1.9f
+// fuel pulse (us) per % VE per kPa of map: (m^3 per %) * (Pa per kPa) / (J/(kg*K)) / (K) / (ratio) / (kg/s) * (us per s)
+#define PULSE_PER_VE_KPA (ENGINE_DISPLACEMENT / 1E8 * 1013 / (R_CONSTANT * AMBIENT_TEMP * AIR_FUEL_RATIO * MASS_FLOW_RATE) * 1E6)
 
-volatile float engineSpeedDPMS;
-volatile float instantDPMS;
+#define CALIBRATION_FACTOR 19   // in tenths, so the tooth ISR can compare tooth times without float math
+
+speed_t engineSpeed;          // engine speed over the last three revolutions
+float rpm;                    // engineSpeed in rpm, for the tables
+volatile ticks_t revWindow;   // time of the last three revolutions
+volatile int cycleTooth;      // teeth passed since TDC
 volatile int teethPassed = 0;
 
-volatile char fuelOpen;       // whether the fuel injector is open
-volatile char chargingSpark;  // whether the spark is charging
+volatile char fuelOpen;       // whether a fuel pulse is armed or the injector is open
+volatile char chargingSpark;  // whether a spark pulse is armed or the spark is charging
+volatile char sparkCharged;   // whether the spark timer was seen to start charging this spark
+volatile stamp_t sparkChargeEdge; // when the spark timer started charging, read from its counter
+volatile stamp_t sparkFireTime;   // when the spark timer discharged the spark
+volatile char sparkFired;     // whether loop() still has to work out the angle sparkFireTime was at
 
 volatile char useFuel;        // whether or not to use fuel (only fuel every other cycle)
 
-volatile int fuelDuration;    // how long to fuel inject
+volatile ticks_t fuelDuration;    // how long to fuel inject
 
-volatile int lastTick;        // last tachometer interrupt
-volatile int lastTickDelta;   // time difference (us) between last tac interrupt and the previous one
-volatile int prevTick;        // tachometer interrupt before the last one
-volatile int prevTickDelta;   // previous lastTickDelta
+volatile stamp_t lastTick;        // last tachometer interrupt
+volatile ticks_t lastTickDelta;   // time difference between last tac interrupt and the previous one
+volatile stamp_t prevTick;        // tachometer interrupt before the last one
+volatile ticks_t prevTickDelta;   // previous lastTickDelta
 
-volatile int lastRevEnd;        // time when the last cycle ended
-volatile int lastRevDuration;   // duration of the last revolution
-volatile int prevRevEnd;        // time when the previous cycle ended
-volatile int prevRevDuration;   // duration of the previous cycle
+volatile stamp_t lastRevEnd;        // time when the last cycle ended
+volatile ticks_t lastRevDuration;   // duration of the last revolution
+volatile stamp_t prevRevEnd;        // time when the previous cycle ended
+volatile ticks_t prevRevDuration;   // duration of the previous cycle
 
-volatile float lastToothAngle;  // angle of the last tooth that passed by
-volatile float nextToothAngle;
-volatile float approxAngle;   // the approximate engine position is calculated here
+volatile angle_t lastToothAngle;  // angle of the last tooth that passed by
 
 volatile char recalc;         // flag to recalculate stuff after spark for next cycle
 
 
 ///////////////////////////////////////////////////////////////
 
-int killSwitch;
+volatile int killSwitch;
+volatile char killSwitchChanged;  // whether loop() still has to report a kill switch change
+volatile ticks_t toothLatency;    // longest time from a tooth edge to tacISR running, since it was last printed
 
-float sparkAdvAngle;    // angle at which to discharge the spark
-float sparkChargeAngle; // angle at which to begin charging the spark
-int sparkChargeTime;    // in how long to begin charging the spark
+angle_t sparkAdvAngle;    // angle at which to discharge the spark
+angle_t sparkChargeAngle; // angle at which to begin charging the spark
+ticks_t sparkChargeTime;  // in how long to begin charging the spark
 
-float fuelStartAngle;   // angle at which to begin injecting fuel
-int fuelStartTime;      // in how long to begin injecting fuel
-float fuelEndAngle;     // angle at which to stop injecting fuel
-float fuelDurationAngle;  // duration of time to inject fuel
+angle_t fuelStartAngle;   // angle at which to begin injecting fuel
+ticks_t fuelStartTime;    // in how long to begin injecting fuel
+angle_t fuelEndAngle;     // angle at which to stop injecting fuel
+angle_t fuelDurationAngle;  // duration of time to inject fuel
 
-float airVolume;        // volume of air that the engine will intake in m^3
 float mapVal;              // manifold air pressure in kPa
 
+#define PW_RESULT 0     // index of the fuel pulse table in cycleTables
+#define SA_RESULT 1     // index of the SA table in cycleTables
+
+table_t *cycleTables[] = {&PWTable, &SATable};  // tables looked up every cycle
+tableset_t cycleSet = {cycleTables, 2};
+float cycleResults[2];  // results of looking up cycleTables
+
+unsigned long PWVersion;   // version of VETuner that PWTable was worked out from
+
+scheduler_t schedule;   // spark and fuel events for the tooth ISR to arm
+crankobserver_t observer;   // crank speed and acceleration, for timing the events
+char planned;           // whether this cycle's angles are worked out, so events can be planned from them
+char replan;            // whether the events should be planned again from a newer tooth
+int sparkCycle = -1;    // schedule cycle the spark was last charged in
+int fuelCycle = -1;     // schedule cycle fuel was last started in
+angle_t toothAngles[NUM_TEETH];   // angle of each tooth, counting from the first one after TDC
+
+latency_t fuelLatency;     // how late the fuel timer edges run
+latency_t sparkLatency;    // how late the spark timer edges run
+
+long rpmKey;                  // this cycle's rpm, in steps of MEMO_RPM_STEP
+long mapKey;                  // this cycle's map, in steps of MEMO_MAP_STEP
+long memoRpmKey;              // rpmKey that the current results were calculated for
+long memoMapKey;              // mapKey that the current results were calculated for
+char memoValid;               // whether the current results can be reused
+unsigned long memoHits;       // cycles that reused the last results
+unsigned long memoMisses;     // cycles that recalculated them
+unsigned long memoMissTime;   // total time (us) spent recalculating
+stamp_t memoStart;
+
 //////////////////////////////////////////////////////////////
 
 int printStuff;      // use this to print things every n cycles
+int printLine;       // next line of telemetry for printTelemetry to send, 0 once it has sent them all
 
 void setup() {
+   int i, first;
 
    SERIAL_INTERFACE.begin(115200);
+   SERIAL_INTERFACE.print("tune ");
+   SERIAL_INTERFACE.println(TUNE_HASH, HEX);
 
    pinMode(TAC_IN, INPUT);
    pinMode(MAP_IN, INPUT);
@@ -104,41 +169,215 @@ void setup() {
    digitalWrite(FUEL_OUT, LOW);
    digitalWrite(SPARK_OUT, LOW);
 
-   engineSpeedDPMS = 0;
+   engineSpeed = speed_t(0);
+   rpm = 0;
    killSwitch = digitalRead(KILL_SWITCH_IN);
-   prevRevDuration = 0;
-   lastRevDuration = 0;
+   prevRevDuration = ticks_t(0);
+   lastRevDuration = ticks_t(0);
 
    chargingSpark = FALSE;
    fuelOpen = FALSE;
 
    printStuff = 0;
+   printLine = 0;
 
    useFuel = FALSE;            // use fuel on the first cycle and every other cycle thereafter
    recalc = FALSE;
+   memoValid = FALSE;
+
+   // the teeth from the missing one on are at CALIB_ANGLE, CALIB_ANGLE + ANGLE_PER_TOOTH and so on,
+   // so start counting them at the first one that is past TDC
+   first = 0;
+   while (first < NUM_TEETH && CALIB_ANGLE + first * ANGLE_PER_TOOTH < TDC)
+      first++;
+   for (i = 0; i < NUM_TEETH; i++) {
+      toothAngles[i] = CALIB_ANGLE + ((first + i) % NUM_TEETH) * ANGLE_PER_TOOTH;
+      if (toothAngles[i] >= TDC)
+         toothAngles[i] -= DEGREES_PER_CYCLE;
+   }
+   latencyInit(&fuelLatency, ARM_LATENCY);   // these learn the real latency as the engine runs
+   latencyInit(&sparkLatency, ARM_LATENCY);
+   schedulerInit(&schedule, toothAngles, NUM_TEETH, ANGLE_PER_TOOTH);   // arm events at least a tooth ahead
+   observerInit(&observer, NUM_TEETH, DEGREES_PER_CYCLE);
+   planned = FALSE;
+   replan = FALSE;
+
+   tunerInit(&VETuner, &VETable);   // allow the tables to be tuned while running
+   tunerInit(&SATuner, &SATable);
+#if PW_COEFS
+   tableUseCoefs(&PWTable, PWCoefs);   // look these up through cell coefficients
+#endif
+#if SA_COEFS
+   tableUseCoefs(&SATable, SACoefs);
+#endif
+#if DENSE_GRIDS
+   denseInit(&PWGrid, &PWTable, GRID_SIZE, GRID_SIZE, PWGridData);
+   denseInit(&SAGrid, &SATable, GRID_SIZE, GRID_SIZE, SAGridData);   // SATuner keeps this up to date
+   SATuner.grid = &SAGrid;
+#endif
+   derivePulseTable();
 
    attachInterrupt(KILL_SWITCH_IN, killSwitchISR, CHANGE);
-   attachInterrupt(TAC_IN, tacISR, RISING); // set up the tachometer ISR
-   SPARK_TIMER.attachInterrupt(sparkISR);    // set up the spark ISR
-   FUEL_TIMER.attachInterrupt(fuelISR);      // set up the fuel injection ISR
+
+   // tach first, then spark, then fuel, and then everything else, so a tooth edge
+   // never waits behind a slow ISR. attachInterrupt puts the pin ports at 0, so this comes after it
+   TICK_TIMER.setPriority(TACH_PRIORITY);
+   SPARK_TIMER.setPriority(SPARK_PRIORITY);
+   FUEL_TIMER.setPriority(FUEL_PRIORITY);
+   NVIC_SetPriority((IRQn_Type)g_APinDescription[KILL_SWITCH_IN].ulPeripheralId, OTHER_PRIORITY);
+   NVIC_SetPriority(UART_IRQn, OTHER_PRIORITY);
+   timebaseStart(TAC_IN, RISING); // start timestamping the tachometer, which runs tacISR
 }
 
 int messedUp = 0;
 int timesCalibrated = 0;
-float realSparkAngle;
-char sparkConsumed = TRUE;
-char fuelConsumed = TRUE;
-float lastMessedUpAngle;
+angle_t realSparkAngle;    // angle the crank was at when the spark fired, from the observer
+angle_t sparkAngleError;   // how far realSparkAngle was from sparkAdvAngle
+angle_t sparkTrim;            // how much earlier to aim the spark, learned from sparkAngleError
+angle_t sparkTrimSum;         // sparkTrim times 2^LATENCY_SHIFT, so small errors are not lost
+angle_t lastMessedUpAngle;
 int lastMessedUpToothCount;
 
-int volEff;
+/*    This is a function used to turn a VE value into a fuel pulse
+   per kPa of map (us/kPa) at a point in the VE table.
+   tableDerive also passes the rpm and map of the point,
+   which the pulse per kPa does not depend on. */
+float pulseFromVE(float volEff, float /* rpm */, float /* map */) {
+   if (volEff < 0)
+      return defaultPW;
+   return volEff * PULSE_PER_VE_KPA;
+}
+
+/*    This is a function used to work PWTable out from VETable again,
+   along with anything that is built from PWTable. */
+void derivePulseTable() {
+   tableDerive(&PWTable, &dataPW[0][0], &VETable, pulseFromVE);
+#if DENSE_GRIDS
+   denseBuild(&PWGrid);
+#endif
+   PWVersion = VETuner.version;
+}
+
+/*    This is a function used to print the next line of telemetry, if there is room for it.
+   Serial blocks once its buffer is full, which would hold loop() up
+   long enough to miss events, so this never prints more than fits,
+   and the telemetry goes out over a few passes of loop(). */
+void printTelemetry() {
+   if (!printLine || SERIAL_INTERFACE.availableForWrite() < PRINT_LINE_ROOM)
+      return;
+
+   switch (printLine++) {
+   case 1:
+      SERIAL_INTERFACE.println("map(%atm)   spark(deg)     fuel pulse(us)          rpm");
+      break;
+   case 2:
+      SERIAL_INTERFACE.print(mapVal, 6);
+      SERIAL_INTERFACE.print("       ");
+      SERIAL_INTERFACE.print(angleToDegrees(sparkAdvAngle), 3);
+      SERIAL_INTERFACE.print("            ");
+      SERIAL_INTERFACE.print(ticksToMicros(fuelDuration));
+      SERIAL_INTERFACE.print("            ");
+      SERIAL_INTERFACE.println(rpm);
+      break;
+   case 3:
+      SERIAL_INTERFACE.print("messed up times:");
+      SERIAL_INTERFACE.print(messedUp);
+      SERIAL_INTERFACE.print("    times calibrated: ");
+      SERIAL_INTERFACE.println(timesCalibrated);
+      break;
+   case 4:
+      SERIAL_INTERFACE.print("real spark angle: ");
+      SERIAL_INTERFACE.print(angleToDegrees(realSparkAngle));
+      SERIAL_INTERFACE.print("    error: ");
+      SERIAL_INTERFACE.print(angleToDegrees(sparkAngleError));
+      SERIAL_INTERFACE.print("    trim: ");
+      SERIAL_INTERFACE.println(angleToDegrees(sparkTrim));
+      break;
+   case 5:
+      SERIAL_INTERFACE.print("fuel latency(us): ");
+      SERIAL_INTERFACE.print(ticksToMicros(fuelLatency.estimate));
+      SERIAL_INTERFACE.print("    residual: ");
+      SERIAL_INTERFACE.println(ticksToMicros(fuelLatency.residual));
+      break;
+   case 6:
+      SERIAL_INTERFACE.print("spark latency(us): ");
+      SERIAL_INTERFACE.print(ticksToMicros(sparkLatency.estimate));
+      SERIAL_INTERFACE.print("    residual: ");
+      SERIAL_INTERFACE.println(ticksToMicros(sparkLatency.residual));
+      break;
+   case 7:
+      SERIAL_INTERFACE.print("worst tooth latency(us): ");
+      SERIAL_INTERFACE.println(ticksToMicros(toothLatency));
+      toothLatency = ticks_t(0);
+      break;
+   case 8:
+      SERIAL_INTERFACE.print("memo hits: ");
+      SERIAL_INTERFACE.print(memoHits);
+      SERIAL_INTERFACE.print("    misses: ");
+      SERIAL_INTERFACE.println(memoMisses);
+      break;
+   default:
+      SERIAL_INTERFACE.print("recalc time(us): ");
+      SERIAL_INTERFACE.println(memoMissTime);
+      printLine = 0;   // that was the last line
+      break;
+   }
+}
 
 void loop() {
+   // work out the engine speed from the last three revolutions
+   engineSpeed = speedFrom(DEGREES_PER_CYCLE * 3, revWindow);
+   rpm = speedToRpm(engineSpeed);
+
+   // serial is too slow for an ISR, so the kill switch ISR leaves this for here
+   if (killSwitchChanged && SERIAL_INTERFACE.availableForWrite() >= PRINT_LINE_ROOM) {
+      killSwitchChanged = FALSE;
+      SERIAL_INTERFACE.print("KILL SWITCH ");
+      SERIAL_INTERFACE.println(killSwitch);
+   }
+
+   // plan the events again after every tooth, so they are timed from the newest speed and acceleration.
+   // the list is started before the teeth are read, so one planned from the last cycle's teeth
+   // gets thrown away by the tooth ISR instead of being armed in this one
+   if (observerPending(&observer) || scheduleStale(&schedule)) {
+      scheduleClear(&schedule);
+      observerRun(&observer);
+      replan = TRUE;
+   }
+
+   // once the observer has a tooth from after the spark, work out where the crank really was when it fired
+   if (sparkFired && observerReady(&observer) && observer.refTime >= sparkFireTime) {
+      sparkFired = FALSE;
+      realSparkAngle = observerAngleAt(&observer, sparkFireTime);
+      sparkAngleError = realSparkAngle - sparkAdvAngle;
+      if (sparkAngleError < -DEGREES_PER_CYCLE / 2)   // the tooth after the spark was in the next cycle
+         sparkAngleError = sparkAngleError + DEGREES_PER_CYCLE;
+      else if (sparkAngleError > DEGREES_PER_CYCLE / 2)
+         sparkAngleError = sparkAngleError - DEGREES_PER_CYCLE;
+      realSparkAngle = sparkAdvAngle + sparkAngleError;
+
+      // aim the next spark earlier by however late this one was, a little at a time
+      sparkTrimSum = sparkTrimSum + sparkAngleError;
+      if (sparkTrimSum > SPARK_TRIM_MAX * (1 << LATENCY_SHIFT))
+         sparkTrimSum = SPARK_TRIM_MAX * (1 << LATENCY_SHIFT);
+      else if (sparkTrimSum < -SPARK_TRIM_MAX * (1 << LATENCY_SHIFT))
+         sparkTrimSum = -SPARK_TRIM_MAX * (1 << LATENCY_SHIFT);
+      sparkTrim = angle_t(sparkTrimSum.raw / (1 << LATENCY_SHIFT));
+   }
+
    // only recalculate stuff if it is necessary and if the engine is still running
-   if (killSwitch && recalc && engineSpeedDPMS * 166667 > ACTIVE_RPM) {
+   if (killSwitch && recalc && rpm > ACTIVE_RPM) {
       // use this to print every n cycles
       printStuff++;
 
+      // swap in any table changes now, so a whole cycle uses the same tables
+      if (tunerPublish(&VETuner))
+         memoValid = FALSE;
+      if (tunerPublish(&SATuner))
+         memoValid = FALSE;
+      if (VETuner.version != PWVersion)
+         derivePulseTable();
+
       // read in manifold air pressure (map calibration)
       // NOTE: the last number 0.987167 is 1/1.013 !!!! because division is slow
       mapVal = (75.757 * 3.3 * (float)analogRead(MAP_IN) / (float)1023 + 15.151) * 0.987167;
@@ -150,114 +389,138 @@ void loop() {
       if(mapVal >= 100) 
          mapVal = 99.9f;
 
-      /////////////////////////////////////////////////////////
-      //     FUEL PULSE DURATION CALCULATION
-      ////////////////////////////////////////////////////////// 
-      volEff = tableLookup(&VETable, engineSpeedDPMS * 166667, mapVal);
-
-      // calculate volume of air to be taken in in m^3
-      airVolume =  volEff * ENGINE_DISPLACEMENT / 1E8;
-
-      // airvolume (m^3) * (map in kPa converted to Pa) / (J/(kg*K)) * (K) * (ratio) * (kg/s)
-      fuelDuration = airVolume * mapVal * 1013 / (R_CONSTANT * AMBIENT_TEMP * AIR_FUEL_RATIO * MASS_FLOW_RATE) * 1E6;
-
-      if(volEff < 0) fuelDuration = 3500;
-      ///////////////////////////////////////////////////////// 
-
-      // find out at what angle to begin and end fueling
-      fuelEndAngle = TDC - 60;   // finish fueling 60 degrees before TDC
-      fuelDurationAngle = fuelDuration * engineSpeedDPMS; // calculate the angular displacement during fuel injection
-      fuelStartAngle = fuelEndAngle - fuelDurationAngle; // calculate the angle at which to begin fuel injecting
-
-      // find out at what angle to begin and end charging the spark
-      sparkAdvAngle = TDC - tableLookup(&SATable, engineSpeedDPMS * 166667, mapVal);  // calculate spark advance angle
-      sparkChargeAngle = sparkAdvAngle - DWELLTIME * engineSpeedDPMS; // calculate angle at which to begin charging the spark
-
-      fuelConsumed = FALSE;
-      sparkConsumed = FALSE;
+      // reuse the last cycle's results if the engine has not moved far enough
+      // for the tables to tell the difference
+      rpmKey = (long)(rpm * (1.0f / MEMO_RPM_STEP));
+      mapKey = (long)(mapVal * (1.0f / MEMO_MAP_STEP));
+      if (memoValid && rpmKey == memoRpmKey && mapKey == memoMapKey) {
+         memoHits++;
+      }
+      else {
+         memoStart = timebaseNow();
+
+         // look up all of the tables for this rpm and map in one pass
+#if DENSE_GRIDS
+         cycleResults[PW_RESULT] = denseLookup(&PWGrid, rpm, mapVal);
+         cycleResults[SA_RESULT] = denseLookup(&SAGrid, rpm, mapVal);
+#else
+         tableSetLookup(&cycleSet, rpm, mapVal, cycleResults);
+#endif
+
+         /////////////////////////////////////////////////////////
+         //     FUEL PULSE DURATION CALCULATION
+         ////////////////////////////////////////////////////////// 
+         // PWTable already has VE and the engine constants folded in
+         fuelDuration = ticksMicros(cycleResults[PW_RESULT] * mapVal);
+
+         if(cycleResults[PW_RESULT] < 0) fuelDuration = ticksMicros(3500);
+         ///////////////////////////////////////////////////////// 
+
+         // find out at what angle to end fueling and to discharge the spark.
+         // where to begin them depends on how the crank is speeding up, so that is left for planning
+         fuelEndAngle = TDC - angleDegrees(60);   // finish fueling 60 degrees before TDC
+         sparkAdvAngle = TDC - angleDegrees(cycleResults[SA_RESULT]);  // calculate spark advance angle
+
+         memoRpmKey = rpmKey;
+         memoMapKey = mapKey;
+         memoValid = TRUE;
+         memoMisses++;
+         memoMissTime += ticksToMicros(timebaseNow() - memoStart);
+      }
 
+      planned = TRUE;
       recalc = FALSE;
    }
 
-   else if (printStuff == 10)
+   else if (printStuff >= 10 && !printLine)
    {
       printStuff = 0;
-      SERIAL_INTERFACE.println("map(%atm)   spark(deg)     fuel pulse(us)          rpm");
-      SERIAL_INTERFACE.print(mapVal, 6);
-      SERIAL_INTERFACE.print("       ");
-      SERIAL_INTERFACE.print(sparkAdvAngle, 3);
-      SERIAL_INTERFACE.print("            ");
-      SERIAL_INTERFACE.print(fuelDuration);
-      SERIAL_INTERFACE.print("            ");
-      SERIAL_INTERFACE.println(engineSpeedDPMS * 166667);
-      SERIAL_INTERFACE.print("messed up times:");
-      SERIAL_INTERFACE.print(messedUp);
-      SERIAL_INTERFACE.print("    times calibrated: ");
-      SERIAL_INTERFACE.print(timesCalibrated);
-      SERIAL_INTERFACE.print("    real spark angle: ");
-      SERIAL_INTERFACE.println(realSparkAngle);
+      printLine = 1;    // printTelemetry sends it a line at a time from here
    }
+
+   if (!killSwitch || rpm <= ACTIVE_RPM)
+      planned = FALSE;
+
+   // hand this cycle's events to the tooth ISR, timed from where the observer says the crank will be
+   if (replan && planned && observerReady(&observer)) {
+      sparkChargeAngle = observerAngleBefore(&observer, sparkAdvAngle - sparkTrim, DWELLTIME);  // charge for DWELLTIME before discharging
+      fuelStartAngle = observerAngleBefore(&observer, fuelEndAngle, fuelDuration);  // inject for fuelDuration before fuelEndAngle
+      fuelDurationAngle = fuelEndAngle - fuelStartAngle;
+
+      scheduleAdd(&schedule, sparkChargeAngle, &observer, chargeSpark);
+      if (useFuel)
+         scheduleAdd(&schedule, fuelStartAngle, &observer, startFuel);
+      schedulePublish(&schedule);
+      replan = FALSE;
+   }
+
+   // events are planned first, so telemetry only ever uses the time left over
+   printTelemetry();
 }
 
-//fuel injection
-void fuelISR()
+//the fuel timer has opened the injector, or has closed it
+void fuelISR(uint32_t status)
 {
-   FUEL_TIMER.stop();   // prevent timer from restarting
-
-   if (fuelOpen)  // if currently injecting fuel
-   {
-      digitalWrite(FUEL_OUT, LOW);  // close fuel injector
+   // the counter stops when the injector closes, so the opening can only be timed before that
+   if ((status & TC_SR_CPBS) && !(status & TC_SR_CPCS))
+      latencyEdge(&fuelLatency, timebaseCompared<FUEL_TIMER_NUMBER>(FUEL_CHANNEL::channel()->TC_RB));
+   if (status & TC_SR_CPCS)
       fuelOpen = FALSE;             // no longer injecting fuel
-   }
-   else           // if currently not injecting fuel
-   {
-      digitalWrite(FUEL_OUT, HIGH); // open fuel injector
-      fuelOpen = TRUE;              // currently injecting fuel
-      if (fuelDuration > INTERRUPT_LATENCY_US)
-         FUEL_TIMER.start(fuelDuration - INTERRUPT_LATENCY_US); // inject for fuel duration and then stop
-      else
-         FUEL_TIMER.start(1);
-   }
 }
 
-//spark advance
-void sparkISR()
+//the spark timer has started charging the spark, or has discharged it
+void sparkISR(uint32_t status)
 {
-   SPARK_TIMER.stop();  // prevent timer from restarting
+   TcChannel *channel = SPARK_CHANNEL::channel();
 
-   if (chargingSpark)   // if charging, time to discharge!
-   {
-      // send signal to discharge
-      realSparkAngle = lastToothAngle + (micros() - lastTick) * instantDPMS;
-      digitalWrite(SPARK_OUT, LOW);
-      chargingSpark = FALSE;  // no longer charging
-   }
-   else  // if not charging, time to charge
-   {
-      // send signal to begin charge
-      digitalWrite(SPARK_OUT, HIGH);
-      chargingSpark = TRUE;   // currently charging spark
-      SPARK_TIMER.start(DWELLTIME - INTERRUPT_LATENCY_US); // discharge after DWELLTIME us
+   // the counter stops at the discharge, so the charge can only be timed before that
+   if ((status & TC_SR_CPAS) && !(status & TC_SR_CPCS)) {
+      sparkChargeEdge = timebaseCompared<SPARK_TIMER_NUMBER>(channel->TC_RA);
+      latencyEdge(&sparkLatency, sparkChargeEdge);
+      sparkCharged = TRUE;
    }
+   if (!(status & TC_SR_CPCS))
+      return;
+   chargingSpark = FALSE;  // no longer charging
+   if (!sparkCharged)
+      return;
+   sparkCharged = FALSE;
+
+   // the timer discharges the spark on its own count, RC - RA after it started charging.
+   // loop() works out the angle that was at from the observer
+   sparkFireTime = sparkChargeEdge + ticks_t((int32_t)(channel->TC_RC - channel->TC_RA));
+   sparkFired = TRUE;
 }
 
-int prevPrevRevDuration;
+ticks_t prevPrevRevDuration;
+
+// the tick timer, which counts the timebase and timestamps the tachometer
+void tickISR(uint32_t status)
+{
+   if (status & TIMEBASE_STATUS)
+      timebaseNow();   // keep the timebase's wraps counted even when nothing else reads it
+   if (status & TC_SR_LDRAS)
+      tacISR();
+}
 
 // tachometer
 void tacISR()
 {
+   ticks_t held;
+
    prevTick = lastTick;    // keep track of the previous tachometer tick.
-   lastTick = micros();    // record the current tachometer tick
+   lastTick = timebaseCaptured();  // record the tachometer tick, as latched by the timer on the edge
+   held = timebaseNow() - lastTick;   // how long this ISR was held up after the edge
+   if (held > toothLatency)
+      toothLatency = held;
 
    prevTickDelta = lastTickDelta;
    lastTickDelta = lastTick - prevTick; // calculate time between lastTick and prevTick
 
-   instantDPMS = ANGLE_PER_TOOTH / lastTickDelta;
-
-   if(lastTickDelta > prevTickDelta * CALIBRATION_FACTOR)
+   if(lastTickDelta.raw * 10 > prevTickDelta.raw * CALIBRATION_FACTOR)
    {
       timesCalibrated++;
-      if(lastToothAngle != 120.0f) 
+      if(lastToothAngle != angleDegrees(120)) 
       {
          messedUp++; // count how many times we calibrated inaccurately
          lastMessedUpAngle = lastToothAngle;
@@ -271,10 +534,12 @@ void tacISR()
    {
       teethPassed = 0;
    }
+
+   ++cycleTooth;
       
 
    // if the difference between the ticks is greater than CALIBRATION_FACTOR times, we reached the calibration position.
-   if (lastTickDelta > prevTickDelta * CALIBRATION_FACTOR || teethPassed == 0) {
+   if (lastTickDelta.raw * 10 > prevTickDelta.raw * CALIBRATION_FACTOR || teethPassed == 0) {
       teethPassed = 0;
       prevRevEnd = lastRevEnd;
       lastRevEnd = lastTick;
@@ -282,45 +547,75 @@ void tacISR()
       prevRevDuration = lastRevDuration;
       lastRevDuration = lastRevEnd - prevRevEnd;
       lastToothAngle = CALIB_ANGLE;
-      engineSpeedDPMS = DEGREES_PER_CYCLE * 3.0f / (prevPrevRevDuration + prevRevDuration + lastRevDuration);
-      instantDPMS *= 2.0f;
+      revWindow = prevPrevRevDuration + prevRevDuration + lastRevDuration;  // loop() works out the engine speed from this
    }
    else
    {
-      lastToothAngle += ANGLE_PER_TOOTH;
+      lastToothAngle = lastToothAngle + ANGLE_PER_TOOTH;
       // as soon as we pass top dead center, start a new cycle
       if(lastToothAngle >= TDC)
       {
          recalc = TRUE;          // new cycle means we should recalculate!
-         lastToothAngle -= DEGREES_PER_CYCLE;  // since we passed TDC, normalize lastToothAngle for the next cycle
+         lastToothAngle = lastToothAngle - DEGREES_PER_CYCLE;  // since we passed TDC, normalize lastToothAngle for the next cycle
          useFuel = !useFuel;     // if we just fueled, not necessary to fuel on the next cycle
+         cycleTooth = 0;
+         scheduleCycle(&schedule);   // lists planned in the last cycle are no good now
       }      
    }
    
-   nextToothAngle = lastToothAngle + ANGLE_PER_TOOTH;
-   // if we're not charging spark and spark charge angle is going to be between the next two tac ticks
-   if(!sparkConsumed && !chargingSpark && sparkChargeAngle < nextToothAngle + ANGLE_PER_TOOTH && nextToothAngle <= sparkChargeAngle)
-   {
-      approxAngle = lastToothAngle + (micros() - lastTick) * instantDPMS;
-      sparkChargeTime = (sparkChargeAngle - approxAngle) / instantDPMS;
-      SPARK_TIMER.start(sparkChargeTime - INTERRUPT_LATENCY_US); // set timer to begin charging spark on time
-      sparkConsumed = TRUE;
-   }
+   observerTooth(&observer, lastTick, lastToothAngle);   // loop() works out the speed and acceleration from these
 
-   // if we're not fueling and we need to fuel and the fuel start angle is between the next two tac ticks
-   if (!fuelConsumed && !fuelOpen && useFuel && fuelStartAngle < nextToothAngle + ANGLE_PER_TOOTH && nextToothAngle <= fuelStartAngle) 
-   {
-      approxAngle = lastToothAngle + (micros() - lastTick) * instantDPMS;
-      fuelStartTime = (fuelStartAngle - approxAngle) / instantDPMS;
-      FUEL_TIMER.start(fuelStartTime - INTERRUPT_LATENCY_US); // set timer to begin injecting on time
-      fuelConsumed = TRUE;
-   }
+   // arm any events that loop() put on this tooth
+   scheduleTooth(&schedule, cycleTooth);
+}
+
+// the timer ISRs are bound at compile time, so they are called straight from the interrupt
+DUETIMER_STATUS_HANDLER(TICK_TIMER_NUMBER, tickISR)   // timebase and tachometer
+DUETIMER_STATUS_HANDLER(SPARK_TIMER_NUMBER, sparkISR)    // spark has started charging or has fired
+DUETIMER_STATUS_HANDLER(FUEL_TIMER_NUMBER, fuelISR)      // fuel injection has started or has finished
 
+// begin charging the spark delay after the last tooth
+void chargeSpark(ticks_t delay)
+{
+   stamp_t now;
+   ticks_t wait;
+
+   // a newer plan can move an event to a later tooth after it already happened, so only once a cycle
+   if (chargingSpark || sparkCycle == schedule.cycle)
+      return;
+   sparkCycle = schedule.cycle;
+   sparkChargeTime = delay;
+
+   // the timer charges the spark after wait and discharges it DWELLTIME after that
+   now = timebaseNow();
+   wait = latencyArm(&sparkLatency, lastTick + delay, now);
+   SPARK_TIMER.startPulse(SPARK_OUT, wait.raw, DWELLTIME.raw);
+   SPARK_CHANNEL::channel()->TC_IER = TC_IER_CPAS;   // so sparkISR can time the charge from the counter
+   sparkCharged = FALSE;
+   chargingSpark = TRUE;
+}
+
+// begin injecting fuel delay after the last tooth
+void startFuel(ticks_t delay)
+{
+   stamp_t now;
+   ticks_t wait;
+
+   if (fuelOpen || fuelCycle == schedule.cycle)
+      return;
+   fuelCycle = schedule.cycle;
+   fuelStartTime = delay;
+
+   // the timer opens the injector after wait and closes it fuelDuration after that
+   now = timebaseNow();
+   wait = latencyArm(&fuelLatency, lastTick + delay, now);
+   FUEL_TIMER.startPulse(FUEL_OUT, wait.raw, fuelDuration.raw);
+   FUEL_CHANNEL::channel()->TC_IER = TC_IER_CPBS;   // so fuelISR can time the opening from the counter
+   fuelOpen = TRUE;
 }
 
 void killSwitchISR()
 {
    killSwitch = digitalRead(KILL_SWITCH_IN);
-   SERIAL_INTERFACE.print("KILL SWITCH ");
-   SERIAL_INTERFACE.println(killSwitch);
+   killSwitchChanged = TRUE;   // loop() reports it
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+//latency.cpp
+#include "latency.h"
+
+/*    This is a function used to set up a latency tracker. */
+void latencyInit(latency_t *latency, ticks_t estimate) {
+   latency->estimate = estimate;
+   latency->filtered = estimate * (1 << LATENCY_SHIFT);
+   latency->residual = ticks_t(0);
+   latency->residualSum = ticks_t(0);
+   latency->lateness = ticks_t(0);
+   latency->target = stamp_t(0);
+   latency->armed = 0;
+}
+
+/*    This is a function used to arm an edge that should happen at target. */
+ticks_t latencyArm(latency_t *latency, stamp_t target, stamp_t now) {
+   ticks_t wait = (target - now) - latency->estimate;
+
+   // an edge that is already too close to make on time would only
+   // make the estimate look worse than it is, so it is not measured
+   latency->target = target;
+   latency->armed = wait >= ticks_t(1);
+   if (wait < ticks_t(1))
+      return ticks_t(1);
+   return wait;
+}
+
+/*    This is a function used to measure an edge that was armed. */
+void latencyEdge(latency_t *latency, stamp_t now) {
+   ticks_t late, size;
+
+   if (!latency->armed)
+      return;
+   latency->armed = 0;
+
+   // the estimate is already taken off, so whatever lateness is left
+   // means the estimate is that far off
+   late = now - latency->target;
+   latency->lateness = late;
+   latency->filtered += late;
+   if (latency->filtered < ticks_t(0))
+      latency->filtered = ticks_t(0);
+   else if (latency->filtered > LATENCY_MAX * (1 << LATENCY_SHIFT))
+      latency->filtered = LATENCY_MAX * (1 << LATENCY_SHIFT);
+   latency->estimate = ticks_t((latency->filtered.raw + (1 << (LATENCY_SHIFT - 1))) >> LATENCY_SHIFT);
+
+   size = late < ticks_t(0) ? -late : late;
+   latency->residualSum += size - latency->residual;
+   latency->residual = ticks_t(latency->residualSum.raw >> LATENCY_SHIFT);
+}
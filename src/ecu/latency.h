@@ -0,0 +1,49 @@
+//latency.h
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "timebase.h"
+
+/*  The estimate moves 1/2^LATENCY_SHIFT of the way towards each new measurement. */
+#define LATENCY_SHIFT 3
+
+/*  The estimate is kept between 0 and this, so a bad edge cannot throw it off. */
+#define LATENCY_MAX ticksMicros(1000)
+
+/*  This is the latency tracker for one output channel.
+   Every time its timer is armed for an edge at some target time,
+   whatever knows when the edge really happened measures how late it was,
+   and the estimate is nudged so the next edge gets armed that much earlier.
+   That can be the edge ISR reading the time, or, when a timer drives
+   the edge itself, its compare ISR reading how far its counter has got
+   since the edge, with timebaseCompared.
+   That way the estimate keeps up with ISR load, clocks and compiler
+   settings, instead of being a number someone measured once.
+   residual is how far off the edges still are on average after
+   the estimate is taken off, and is only there for telemetry. */
+typedef struct latency_t {
+   ticks_t estimate;    // how much later than asked for the edges happen
+   ticks_t filtered;    // estimate times 2^LATENCY_SHIFT, so small corrections are not lost
+   ticks_t residual;    // average size of lateness, after compensating
+   ticks_t residualSum; // residual times 2^LATENCY_SHIFT
+   ticks_t lateness;    // how late the last edge was, early is negative
+   stamp_t target;      // when the edge that is armed should happen
+   volatile char armed; // whether an edge is armed and not measured yet
+} latency_t;
+
+/*    This is a function used to set up a latency tracker.
+   estimate is the starting guess for the latency. */
+void latencyInit(latency_t *latency, ticks_t estimate);
+
+/*    This is a function used to arm an edge that should happen at target.
+   now is the current time. It returns how long to set the timer for,
+   which is never less than a tick, so an edge that is already too close
+   just happens as soon as it can, and is not measured. */
+ticks_t latencyArm(latency_t *latency, stamp_t target, stamp_t now);
+
+/*    This is a function used to measure an edge that was armed.
+   now is when the edge really happened.
+   Edges that were not armed through latencyArm are ignored. */
+void latencyEdge(latency_t *latency, stamp_t now);
+
+#endif
@@ -0,0 +1,143 @@
+//observer.cpp
+#include <math.h>
+#include "observer.h"
+
+/* This keeps the compiler from moving the writes to the ring
+   past the write to head that hands them over. */
+#define OBSERVER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/*  The crank is never predicted to slow down below this part of its speed,
+   so a hard deceleration cannot make it stop or turn backwards. */
+#define OBSERVER_SLOWEST 0.25f
+
+/*    This is a function used to set up an observer that has not seen any teeth. */
+void observerInit(crankobserver_t *observer, int teeth, angle_t cycle) {
+   observer->head = 0;
+   observer->tail = 0;
+   observer->index = 0;
+   observer->teeth = teeth;
+   observer->cycle = cycle;
+   observer->refTime = stamp_t(0);
+   observer->refAngle = angle_t(0);
+   observer->speed = 0;
+   observer->accel = 0;
+   observer->seen = 0;
+}
+
+/*    This is a function used by the tooth ISR to hand over a tooth. */
+void observerTooth(crankobserver_t *observer, stamp_t time, angle_t angle) {
+   unsigned char head = observer->head;
+
+   observer->times[head & (OBSERVER_TEETH - 1)] = time;
+   observer->angles[head & (OBSERVER_TEETH - 1)] = angle;
+   OBSERVER_BARRIER();
+   observer->head = head + 1;
+}
+
+/* This is a helper function used to run the filter on one tooth. */
+static void observerUpdate(crankobserver_t *observer, stamp_t time, angle_t angle) {
+   ticks_t dt = time - observer->refTime;
+   ticks_t window;
+   float measured, middle, half, error;
+
+   if (observer->seen > 0 && (dt <= ticks_t(0) || dt > OBSERVER_STALL))
+      observer->seen = 0;
+
+   observer->history[observer->index & (OBSERVER_TEETH - 1)] = time;
+   if (observer->seen >= observer->teeth) {
+      // this tooth was at the same angle a cycle ago, so the time since then
+      // gives the average speed over the cycle, which is the speed halfway
+      // through it if the acceleration is steady
+      window = time - observer->history[(observer->index - observer->teeth) & (OBSERVER_TEETH - 1)];
+      measured = (float)observer->cycle.raw / window.raw;
+      half = 0.5f * window.raw;
+      if (observer->seen == observer->teeth) {
+         observer->speed = measured;
+         observer->accel = 0;
+      }
+      else {
+         observer->speed += observer->accel * dt.raw;
+         middle = observer->speed - observer->accel * half;
+         error = measured - middle;
+         observer->speed += OBSERVER_ALPHA * error;
+         observer->accel += OBSERVER_BETA * error / half;
+      }
+   }
+   observer->index++;
+   if (observer->seen <= observer->teeth)
+      observer->seen++;
+   observer->refTime = time;
+   observer->refAngle = angle;
+}
+
+/*    This is a function used to see if there are teeth waiting for observerRun. */
+int observerPending(const crankobserver_t *observer) {
+   return observer->head != observer->tail;
+}
+
+/*    This is a function used by loop() to run the filter on every new tooth. */
+void observerRun(crankobserver_t *observer) {
+   unsigned char head = observer->head;
+   unsigned char i;
+
+   OBSERVER_BARRIER();
+   if ((unsigned char)(head - observer->tail) > OBSERVER_TEETH) {
+      observer->tail = head;
+      observer->seen = 0;
+      return;
+   }
+   for (; observer->tail != head; observer->tail++) {
+      i = observer->tail & (OBSERVER_TEETH - 1);
+      observerUpdate(observer, observer->times[i], observer->angles[i]);
+   }
+}
+
+/*    This is a function used to see if the observer has seen enough teeth. */
+int observerReady(const crankobserver_t *observer) {
+   return observer->seen > observer->teeth && observer->speed > 0;
+}
+
+/* This is a helper function used to predict how long after the last tooth
+   the crank gets to angle. With steady acceleration the speed after
+   turning d is sqrt(speed^2 + 2 accel d), and the time is d over the
+   average of that and the speed now. */
+static float observerTimeTo(const crankobserver_t *observer, angle_t angle) {
+   float d = (float)(angle - observer->refAngle).raw;
+   float slowest = observer->speed * OBSERVER_SLOWEST;
+   float square = observer->speed * observer->speed + 2 * observer->accel * d;
+   float end = square > slowest * slowest ? sqrtf(square) : slowest;
+
+   return 2 * d / (observer->speed + end);
+}
+
+/*    This is a function used to predict how long the crank will take to turn between two angles. */
+ticks_t observerTicks(const crankobserver_t *observer, angle_t from, angle_t to) {
+   float t;
+
+   if (!observerReady(observer))
+      return ticks_t(INT32_MAX);
+   t = observerTimeTo(observer, to) - observerTimeTo(observer, from);
+   return ticks_t(unitClamp((int64_t)(t + 0.5f)));
+}
+
+/* This is a helper function used to work out the angle the crank is at
+   t ticks after the last tooth, which can be negative for before it. */
+static angle_t observerAngleAfter(const crankobserver_t *observer, float t) {
+   float end = observer->speed + observer->accel * t;
+
+   if (end < observer->speed * OBSERVER_SLOWEST)
+      end = observer->speed * OBSERVER_SLOWEST;
+   return observer->refAngle + angle_t((int32_t)(t * 0.5f * (observer->speed + end)));
+}
+
+/*    This is a function used to predict the angle the crank will be at time before it reaches angle. */
+angle_t observerAngleBefore(const crankobserver_t *observer, angle_t angle, ticks_t time) {
+   if (!observerReady(observer))
+      return angle;
+   return observerAngleAfter(observer, observerTimeTo(observer, angle) - time.raw);
+}
+
+/*    This is a function used to work out what angle the crank was at, or will be at, at a time. */
+angle_t observerAngleAt(const crankobserver_t *observer, stamp_t time) {
+   return observerAngleAfter(observer, (float)(time - observer->refTime).raw);
+}
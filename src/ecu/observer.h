@@ -0,0 +1,89 @@
+//observer.h
+#ifndef OBSERVER_H
+#define OBSERVER_H
+
+#include "timebase.h"
+
+/*  This is how many teeth the tooth ISR can get ahead of loop() by,
+   and also the most teeth there can be in a cycle.
+   It has to be a power of 2. */
+#define OBSERVER_TEETH 16
+
+/*  These are the alpha-beta filter gains, for speed and acceleration. */
+#define OBSERVER_ALPHA 0.5f
+#define OBSERVER_BETA 0.2f
+
+/*  A gap between teeth longer than this means the engine stopped,
+   so the observer starts over. */
+#define OBSERVER_STALL ticksMicros(200000)
+
+/*  This is the crank observer struct.
+   It tracks the crank speed and acceleration with an alpha-beta filter,
+   so spark and fuel can be timed for where the crank will be
+   and not just where it would be at a steady speed.
+   On every tooth the filter is given the average speed over the last
+   whole cycle, which slides along a tooth at a time. The crank speeds up
+   and slows down within each cycle as the engine fires and compresses,
+   and a whole cycle always has all of that in it,
+   so only the real change in speed from cycle to cycle gets through.
+   The tooth ISR only drops each tooth's time and angle in a ring,
+   and loop() runs the filter on them, so the ISR stays integer only.
+   The filter state is as of the last tooth it has seen,
+   at refTime and refAngle. speed is in angle per tick,
+   and accel is in angle per tick per tick. */
+typedef struct crankobserver_t {
+   stamp_t times[OBSERVER_TEETH];
+   angle_t angles[OBSERVER_TEETH];
+   volatile unsigned char head;   // where the tooth ISR puts the next tooth
+   unsigned char tail;            // the next tooth for loop() to take
+   stamp_t history[OBSERVER_TEETH];  // when each of the last cycle's teeth went by
+   unsigned char index;           // where the next tooth goes in history
+   int teeth;                     // teeth in a cycle
+   angle_t cycle;                 // angle of a whole cycle, for when the tooth angles wrap
+   stamp_t refTime;
+   angle_t refAngle;
+   float speed;
+   float accel;
+   int seen;                      // teeth seen since starting over, up to teeth + 1
+} crankobserver_t;
+
+/*    This is a function used to set up an observer that has not seen any teeth.
+   There are teeth teeth in a cycle, which can be at most OBSERVER_TEETH - 1.
+   Tooth angles are expected to go from 0 up to cycle and then wrap. */
+void observerInit(crankobserver_t *observer, int teeth, angle_t cycle);
+
+/*    This is a function used by the tooth ISR to hand over a tooth.
+   It does not do any math, so it is safe to call on every tooth. */
+void observerTooth(crankobserver_t *observer, stamp_t time, angle_t angle);
+
+/*    This is a function used to see if there are teeth waiting for observerRun. */
+int observerPending(const crankobserver_t *observer);
+
+/*    This is a function used by loop() to run the filter
+   on every tooth that came in since it was last called.
+   If loop() fell so far behind that teeth were lost, it starts over. */
+void observerRun(crankobserver_t *observer);
+
+/*    This is a function used to see if the observer has seen enough teeth
+   for its predictions to mean anything. */
+int observerReady(const crankobserver_t *observer);
+
+/*    This is a function used to predict how long the crank will take
+   to turn from one angle to another, given how fast it is speeding up.
+   The angles are in the same range as the tooth angles,
+   and can be before or after the last tooth. */
+ticks_t observerTicks(const crankobserver_t *observer, angle_t from, angle_t to);
+
+/*    This is a function used to predict what angle the crank will be at
+   time before it reaches angle, like where to start charging the spark
+   so that it has charged for the dwell time when it fires. */
+angle_t observerAngleBefore(const crankobserver_t *observer, angle_t angle, ticks_t time);
+
+/*    This is a function used to work out what angle the crank was at, or will be at,
+   at a time before or after the last tooth, like when the spark really fired.
+   It is only as good as the teeth on either side of the time, so it is best
+   used once a tooth after it has been run. The angle is not wrapped,
+   so it can come out below 0 or past cycle. */
+angle_t observerAngleAt(const crankobserver_t *observer, stamp_t time);
+
+#endif
@@ -0,0 +1,124 @@
+//scheduler.cpp
+#include "scheduler.h"
+
+/* This keeps the compiler from moving writes to the pending list
+   past the write to scheduler->ready that hands it over. */
+#define SCHEDULE_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/*    This is a function used to set up a scheduler with no events. */
+void schedulerInit(scheduler_t *scheduler, const angle_t *toothAngles, int teeth, angle_t lead) {
+   scheduler->lists[0].count = 0;
+   scheduler->lists[1].count = 0;
+   scheduler->live = &scheduler->lists[0];
+   scheduler->pending = &scheduler->lists[1];
+   scheduler->next = 0;
+   scheduler->ready = 0;
+   scheduler->cycle = 0;
+   scheduler->tooth = -1;
+   scheduler->pendingCycle = 0;
+   scheduler->toothAngles = toothAngles;
+   scheduler->teeth = teeth;
+   scheduler->lead = lead;
+}
+
+/*    This is a function used to start filling in a new list of events. */
+void scheduleClear(scheduler_t *scheduler) {
+   // take the pending list back first, in case the ISR has not picked it up yet
+   scheduler->ready = 0;
+   SCHEDULE_BARRIER();
+   scheduler->pending->count = 0;
+   scheduler->pendingCycle = scheduler->cycle;
+}
+
+/*    This is a function used to add an event at a crank angle. */
+int scheduleAdd(scheduler_t *scheduler, angle_t angle, const crankobserver_t *observer, eventaction_t action) {
+   eventlist_t *list = scheduler->pending;
+   int earliest = scheduler->tooth + 1;
+   int tooth, i;
+   ticks_t delay;
+
+   if (list->count >= MAX_EVENTS) {
+      return 0;
+   }
+
+   // arm it on the last tooth that is at least lead before it
+   for (tooth = scheduler->teeth - 1; tooth >= 0; tooth--) {
+      if (scheduler->toothAngles[tooth] <= angle - scheduler->lead)
+         break;
+   }
+   if (tooth < 0) {
+      return 0;
+   }
+
+   // but never on a tooth that is already gone, where it would be skipped
+   if (tooth < earliest) {
+      if (earliest >= scheduler->teeth) {
+         return 0;
+      }
+      tooth = earliest;
+   }
+   delay = observerTicks(observer, scheduler->toothAngles[tooth], angle);
+   if (delay < ticks_t(0)) {
+      delay = ticks_t(0);
+   }
+
+   // slide the events for later teeth up to keep the list sorted
+   for (i = list->count; i > 0 && list->events[i - 1].tooth > tooth; i--) {
+      list->events[i] = list->events[i - 1];
+   }
+   list->events[i].tooth = tooth;
+   list->events[i].delay = delay;
+   list->events[i].action = action;
+   list->count++;
+   return 1;
+}
+
+/*    This is a function used to hand the list that was filled in to the tooth ISR. */
+void schedulePublish(scheduler_t *scheduler) {
+   SCHEDULE_BARRIER();
+   scheduler->ready = 1;
+}
+
+/*    This is a function used to see if the list being filled in is from an earlier cycle. */
+int scheduleStale(const scheduler_t *scheduler) {
+   return scheduler->pendingCycle != scheduler->cycle;
+}
+
+/*    This is a function used by the tooth ISR when a new cycle starts. */
+void scheduleCycle(scheduler_t *scheduler) {
+   scheduler->cycle++;
+   scheduler->tooth = -1;
+   scheduler->next = scheduler->live->count;   // nothing left from the last cycle gets armed in this one
+}
+
+/*    This is a function used by the tooth ISR to arm every event on this tooth. */
+void scheduleTooth(scheduler_t *scheduler, int tooth) {
+   eventlist_t *list;
+   toothevent_t *event;
+
+   if (scheduler->ready && scheduler->pendingCycle != scheduler->cycle) {
+      scheduler->ready = 0;   // planned for a cycle that is over
+   }
+   if (scheduler->ready && scheduler->pending->count && scheduler->pending->events[0].tooth < tooth) {
+      scheduler->ready = 0;   // planned before the last tooth, so it would miss events
+   }
+   if (scheduler->ready) {
+      list = scheduler->live;
+      scheduler->live = scheduler->pending;
+      scheduler->pending = list;
+      scheduler->next = 0;
+      scheduler->ready = 0;
+   }
+
+   list = scheduler->live;
+   while (scheduler->next < list->count && list->events[scheduler->next].tooth < tooth) {
+      scheduler->next++;
+   }
+
+   while (scheduler->next < list->count && list->events[scheduler->next].tooth == tooth) {
+      event = &list->events[scheduler->next];
+      event->action(event->delay);
+      scheduler->next++;
+   }
+   scheduler->tooth = tooth;
+}
@@ -0,0 +1,96 @@
+//scheduler.h
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "units.h"
+#include "observer.h"
+
+/*  This is the most events that can be scheduled in one cycle. */
+#define MAX_EVENTS 8
+
+/*  This is what an event does when it comes due.
+   It is called from the tooth ISR with how long after the tooth
+   the event should happen, and should arm a timer for it.
+   If its output is still busy from the last event it can just skip it.
+   A newer plan can move an event it has already armed to a later tooth,
+   so it should only act once a cycle. */
+typedef void (*eventaction_t)(ticks_t delay);
+
+/*  This is an event, already worked out as the tooth to arm it on
+   and how long after that tooth it happens, so the tooth ISR
+   does not have to do any float math to arm it. */
+typedef struct toothevent_t {
+   int tooth;
+   ticks_t delay;
+   eventaction_t action;
+} toothevent_t;
+
+/*  This is a list of events, sorted by tooth. */
+typedef struct eventlist_t {
+   toothevent_t events[MAX_EVENTS];
+   int count;
+} eventlist_t;
+
+/*  This is the angle scheduler struct.
+   loop() fills in the pending list each cycle and publishes it,
+   and the tooth ISR takes it over on the next tooth and works through it.
+   Since the list is sorted the ISR only ever looks at the next event,
+   so a tooth costs the same however many events there are.
+   Teeth are counted from the first one after TDC, and toothAngles
+   has the angle of each of them, in that order.
+   A list is only good for the cycle it was started in, so the tooth ISR
+   counts cycles and throws away a list that was started in an earlier one.
+   It also keeps the last tooth it has been through, so loop() never
+   plans an event on a tooth that has already gone by. */
+typedef struct scheduler_t {
+   eventlist_t lists[2];
+   eventlist_t *live;      // the list the tooth ISR is working through
+   eventlist_t *pending;   // the list loop() is filling in
+   int next;               // index in live of the next event to arm
+   volatile char ready;    // whether pending is finished and waiting for the ISR
+   volatile int cycle;     // cycles the tooth ISR has started
+   volatile int tooth;     // last tooth the ISR has been through this cycle, -1 before the first
+   int pendingCycle;       // cycle the pending list was started in
+   const angle_t *toothAngles;
+   int teeth;
+   angle_t lead;           // least angle between the tooth an event is armed on and the event
+} scheduler_t;
+
+/*    This is a function used to set up a scheduler with no events.
+   Events get armed at least lead ahead, so that there is
+   time to arm them after the tooth ISR starts. */
+void schedulerInit(scheduler_t *scheduler, const angle_t *toothAngles, int teeth, angle_t lead);
+
+/*    This is a function used to start filling in a new list of events. */
+void scheduleClear(scheduler_t *scheduler);
+
+/*    This is a function used to add an event at a crank angle to the list
+   being filled in.
+   observer predicts how long the crank takes to get there from its tooth,
+   which becomes the delay after that tooth.
+   An event whose tooth has already gone by this cycle is armed on the
+   next tooth instead, with its delay worked out from that tooth,
+   which is none at all if the crank is already past the event by then.
+   It returns 0 if the list is full or there is no tooth left
+   in the cycle to arm the event on. */
+int scheduleAdd(scheduler_t *scheduler, angle_t angle, const crankobserver_t *observer, eventaction_t action);
+
+/*    This is a function used to hand the list that was filled in to the tooth ISR.
+   Any events left in the old list will not be armed. */
+void schedulePublish(scheduler_t *scheduler);
+
+/*    This is a function used to see if the list being filled in
+   was started in a cycle that has already ended, so it has to be started again. */
+int scheduleStale(const scheduler_t *scheduler);
+
+/*    This is a function used by the tooth ISR when a new cycle starts. */
+void scheduleCycle(scheduler_t *scheduler);
+
+/*    This is a function used by the tooth ISR to arm every event on this tooth.
+   tooth is how many teeth have passed since TDC.
+   A new list with events on teeth that have already gone by was planned
+   before the last tooth, so it is dropped and the old list kept
+   until loop() plans again from this tooth. */
+void scheduleTooth(scheduler_t *scheduler, int tooth);
+
+#endif
@@ -3,50 +3,267 @@
 #include "table.h"
 #include <Arduino.h>
 
-/* This is a helper function used to calculate
-   between which table axis values our desired input values fall. */
-static int findIndex(const float *vals, float in) {
-   int i;
-   for (i = 0; in >= vals[i]; i++);
-   return i - 1;
-}
-
 /*    This is a function used to get table values */
 float getData(table_t *table, int x, int y) {
-   return *(table->data + y * table->width + x);
+   int cell = y * table->width + x;
+   float raw;
+
+   switch (table->type) {
+   case TABLE_UINT8:
+      raw = ((const uint8_t *)table->data)[cell];
+      break;
+   case TABLE_INT16:
+      raw = ((const int16_t *)table->data)[cell];
+      break;
+   default:
+      raw = ((const float *)table->data)[cell];
+      break;
+   }
+
+   if (table->overlay && (table->overlay->rows & OVERLAY_ROW(y)))
+      raw = overlayGet(table->overlay, cell, raw);
+
+   if (table->type == TABLE_FLOAT)
+      return raw;
+   return raw * table->scale + table->offset;
 }
 
 /*    This is a function used to set table values. */
-void setData(table_t *table, int x, int y, float value) {
-   *(table->data + y * table->width + x) = value;
+int setData(table_t *table, int x, int y, float value) {
+   if (!table->overlay) {
+      return 0;
+   }
+   if (!overlaySet(table->overlay, table->width, x, y, tableToRaw(table, value))) {
+      return 0;
+   }
+   tableRefreshCoefs(table, x, y);
+   return 1;
+}
+
+/* This is a helper function used to build the coefficients of one cell
+   from the real values at its four corners. */
+static void tableBuildCell(table_t *table, int x, int y) {
+   tablecoef_t *k = table->coefs + y * (table->width - 1) + x;
+   float c00 = getData(table, x, y);
+   float c10 = getData(table, x + 1, y);
+   float c01 = getData(table, x, y + 1);
+   float c11 = getData(table, x + 1, y + 1);
+
+   k->a = c00;
+   k->b = c10 - c00;
+   k->c = c01 - c00;
+   k->d = c11 - c10 - c01 + c00;
+}
+
+/*    This is a function used to make a table look up through cell coefficients. */
+void tableUseCoefs(table_t *table, tablecoef_t *coefs) {
+   table->coefs = coefs;
+   tableBuildCoefs(table);
+}
+
+/*    This is a function used to rebuild every cell coefficient of a table. */
+void tableBuildCoefs(table_t *table) {
+   int x, y;
+
+   if (!table->coefs) {
+      return;
+   }
+
+   for (y = 0; y < table->height - 1; y++) {
+      for (x = 0; x < table->width - 1; x++) {
+         tableBuildCell(table, x, y);
+      }
+   }
+}
+
+/*    This is a function used to rebuild the cells that use one table value. */
+void tableRefreshCoefs(table_t *table, int x, int y) {
+   int cx, cy;
+
+   if (!table->coefs) {
+      return;
+   }
+
+   // the value is a corner of the cells to its left and above it too
+   for (cy = y - 1; cy <= y; cy++) {
+      for (cx = x - 1; cx <= x; cx++) {
+         if (cx >= 0 && cy >= 0 && cx < table->width - 1 && cy < table->height - 1)
+            tableBuildCell(table, cx, cy);
+      }
+   }
+}
+
+/*    This is a function used to fill in a table that is worked out from another. */
+void tableDerive(table_t *dst, float *data, table_t *src, float (*derive)(float value, float x, float y)) {
+   int x, y;
+
+   for (y = 0; y < src->height; y++) {
+      for (x = 0; x < src->width; x++) {
+         data[y * src->width + x] = derive(getData(src, x, y), src->xVals[x], src->yVals[y]);
+      }
+   }
+   tableBuildCoefs(dst);
+}
+
+/*    This is a function used to turn a real value into a raw table value. */
+float tableToRaw(const table_t *table, float value) {
+   if (table->type == TABLE_FLOAT)
+      return value;
+   return (value - table->offset) / table->scale;
+}
+
+/*    This is a function used to put a tuned cell in an overlay. */
+int overlaySet(overlay_t *overlay, int width, int x, int y, float value) {
+   int cell = y * width + x;
+   int i;
+
+   // if this cell was already tuned, just replace its value
+   for (i = 0; i < overlay->count; i++) {
+      if (overlay->cells[i] == cell) {
+         overlay->values[i] = value;
+         return 1;
+      }
+   }
+
+   if (overlay->count >= OVERLAY_CELLS) {
+      return 0;
+   }
+
+   overlay->cells[overlay->count] = cell;
+   overlay->values[overlay->count] = value;
+   overlay->count++;
+   overlay->rows |= OVERLAY_ROW(y);
+   return 1;
+}
+
+/*    This is a function used to find a cell in an overlay. */
+float overlayGet(const overlay_t *overlay, int cell, float base) {
+   int i;
+
+   for (i = 0; i < overlay->count; i++) {
+      if (overlay->cells[i] == cell)
+         return overlay->values[i];
+   }
+   return base;
 }
 
 /*    This is the main function used to access table data. */
 float tableLookup(table_t *table, float x, float y) {
-   float x_1, x_2, y_1, y_2;
+   return tableInterpolate(table, table->width, table->height, x, y);
+}
+
+/*    This is a function used to look up every table in a set at once. */
+void tableSetLookup(tableset_t *set, float x, float y, float *results) {
+   axispos_t xPos[MAX_SET_TABLES];
+   axispos_t yPos[MAX_SET_TABLES];
+   table_t *table, *other;
+   int i, j;
+
+   for (i = 0; i < set->count; i++) {
+      table = set->tables[i];
+
+      if (x < table->xVals[0]) {
+         results[i] = table->defaultVal;
+         continue;
+      }
+
+      //Reuse the x and y positions from an earlier table with the same axis.
+      for (j = 0; j < i; j++) {
+         other = set->tables[j];
+         if (other->xVals == table->xVals && other->width == table->width && x >= other->xVals[0])
+            break;
+      }
+      if (j < i) {
+         xPos[i] = xPos[j];
+         table->xIndex = xPos[i].index;   // so its own lookups start from this bracket too
+      }
+      else
+         xPos[i] = axisPosition(table->xVals, table->xRecip, table->width, x, &table->xIndex);
+
+      for (j = 0; j < i; j++) {
+         other = set->tables[j];
+         if (other->yVals == table->yVals && other->height == table->height && x >= other->xVals[0])
+            break;
+      }
+      if (j < i) {
+         yPos[i] = yPos[j];
+         table->yIndex = yPos[i].index;
+      }
+      else
+         yPos[i] = axisPosition(table->yVals, table->yRecip, table->height, y, &table->yIndex);
+
+      results[i] = tableBlend(table, table->width, xPos[i], yPos[i]);
+   }
+}
+
+/*    This is a function used to fill a tablefx_t from a table_t. */
+int tableToFixed(table_t *src, tablefx_t *dst) {
+   int i;
+   int32_t width;
+   float value;
+
+   dst->width = src->width;
+   dst->height = src->height;
+   dst->defaultVal = floatToFixed(src->defaultVal);
+   dst->xIndex = 0;
+   dst->yIndex = 0;
+
+   for (i = 0; i < src->width; i++) {
+      if (src->xVals[i] >= 32767 || src->xVals[i] <= -32767) return 0;
+      dst->xVals[i] = floatToFixed(src->xVals[i]);
+   }
+   for (i = 0; i < src->height; i++) {
+      if (src->yVals[i] >= 32767 || src->yVals[i] <= -32767) return 0;
+      dst->yVals[i] = floatToFixed(src->yVals[i]);
+   }
+   for (i = 0; i < src->width * src->height; i++) {
+      value = getData(src, i % src->width, i / src->width);
+      if (value >= 32767 || value <= -32767) return 0;
+      dst->data[i] = floatToFixed(value);
+   }
+
+   // the reciprocal only fits in 31 bits if the segment is wider than 0.5
+   for (i = 0; i < src->width - 1; i++) {
+      width = dst->xVals[i + 1] - dst->xVals[i];
+      if (width <= FIXED_ONE / 2) return 0;
+      dst->xRecip[i] = (int32_t)(((int64_t)1 << (FIXED_SHIFT + WEIGHT_SHIFT)) / width);
+   }
+   for (i = 0; i < src->height - 1; i++) {
+      width = dst->yVals[i + 1] - dst->yVals[i];
+      if (width <= FIXED_ONE / 2) return 0;
+      dst->yRecip[i] = (int32_t)(((int64_t)1 << (FIXED_SHIFT + WEIGHT_SHIFT)) / width);
+   }
+
+   return 1;
+}
+
+/*    This is the fixed point version of tableLookup. */
+fixed_t tableLookupFixed(tablefx_t *table, fixed_t x, fixed_t y) {
    int xIndex, yIndex;
+   int32_t xWeight, yWeight;
+   fixed_t top, bottom;
+   const fixed_t *cell;
 
    if (x < table->xVals[0]) {
       return table->defaultVal;
    }
 
+   //Keep the weights between 0 and 1 so they cannot overflow.
+   if (x > table->xVals[table->width - 1]) x = table->xVals[table->width - 1];
+   if (y > table->yVals[table->height - 1]) y = table->yVals[table->height - 1];
+   if (y < table->yVals[0]) y = table->yVals[0];
+
    //Find the indices for each axis between which our desired values fall.
-   xIndex = findIndex(table->xVals, x);
-   yIndex = findIndex(table->yVals, y);
-
-   //Find the real values of each axis based on the calculated indices.
-   x_1 = table->xVals[xIndex];
-   y_1 = table->yVals[yIndex];
-   x_2 = table->xVals[xIndex + 1];
-   y_2 = table->yVals[yIndex + 1];
-
-   //Return a bilinear interpolation of the data.
-   return (
-      1 / ((x_2 - x_1) * (y_2 - y_1)) * (
-         getData(table, xIndex, yIndex) * (x_2 - x) * (y_2 - y) +
-         getData(table, xIndex + 1, yIndex) * (x - x_1) * (y_2 - y) +
-         getData(table, xIndex, yIndex + 1) * (x_2 - x) * (y - y_1) +
-         getData(table, xIndex + 1, yIndex + 1) * (x - x_1) * (y - y_1)
-      )
-   );
-}
\ No newline at end of file
+   xIndex = tableFindIndex(table->xVals, table->width, x, &table->xIndex);
+   yIndex = tableFindIndex(table->yVals, table->height, y, &table->yIndex);
+
+   //Find how far along each segment we are, from 0 to 1 << WEIGHT_SHIFT.
+   xWeight = (int32_t)(((int64_t)(x - table->xVals[xIndex]) * table->xRecip[xIndex]) >> FIXED_SHIFT);
+   yWeight = (int32_t)(((int64_t)(y - table->yVals[yIndex]) * table->yRecip[yIndex]) >> FIXED_SHIFT);
+
+   //Interpolate along x on both rows, then along y between them.
+   cell = table->data + yIndex * table->width + xIndex;
+   top = cell[0] + (fixed_t)(((int64_t)(cell[1] - cell[0]) * xWeight) >> WEIGHT_SHIFT);
+   bottom = cell[table->width] + (fixed_t)(((int64_t)(cell[table->width + 1] - cell[table->width]) * xWeight) >> WEIGHT_SHIFT);
+   return top + (fixed_t)(((int64_t)(bottom - top) * yWeight) >> WEIGHT_SHIFT);
+}
@@ -3,17 +3,73 @@
 #ifndef TABLE_H
 #define TABLE_H
 
+#include <stdint.h>
+
+/*  This is the table overlay struct.
+   Table data is const so that it stays in flash,
+   and any cells changed while tuning are kept here in RAM instead.
+   Bit y of rows is set if row y (mod 32) has a tuned cell,
+   so lookups can skip the overlay with a single check. */
+#define OVERLAY_CELLS 32
+#define OVERLAY_ROW(y) ((uint32_t)1 << ((y) & 31))
+
+typedef struct overlay_t {
+   uint32_t rows;
+   int count;
+   uint16_t cells[OVERLAY_CELLS];   // y * width + x of each tuned cell
+   float values[OVERLAY_CELLS];
+} overlay_t;
+
+/*  These are the types a table can store its data as.
+   Whole numbers take up less room than floats, so narrow tables
+   keep a scale and offset, and each real value is raw * scale + offset. */
+#define TABLE_FLOAT 0
+#define TABLE_UINT8 1
+#define TABLE_INT16 2
+
+/*  These are the bilinear coefficients for one table cell,
+   so that a value inside the cell is a + b*dx + c*dy + d*dx*dy,
+   where dx and dy go from 0 to 1 across the cell.
+   They are in real units, so any scale and offset is already applied. */
+typedef struct tablecoef_t {
+   float a;
+   float b;
+   float c;
+   float d;
+} tablecoef_t;
+
 /*  This is the table struct.
    It keeps track of the table's x and y values,
-   the data in the table, and how wide the table is.
+   the data in the table, and how wide and tall the table is.
    We need to know how wide the table is
-   to support multidimensional tables. */
+   to support multidimensional tables.
+   xRecip and yRecip are optional lists of 1 / (vals[i + 1] - vals[i])
+   for each axis, so that lookups can multiply instead of divide.
+   type says what data points to, and scale and offset are
+   only used when it is not TABLE_FLOAT.
+   overlay holds any tuned cells, and can be NULL for a fixed table.
+   Overlay values are raw values, the same as the data.
+   coefs is an optional list of (width - 1) * (height - 1) cell coefficients
+   in RAM. If it is set, lookups blend with them instead of the data,
+   so they have to be rebuilt whenever the data or overlay changes.
+   xIndex and yIndex remember the bracket used by the last lookup,
+   since the engine usually stays in the same cell between cycles. */
 typedef struct table_t {
-   float *xVals;
-   float *yVals;
-   float *data;
+   const float *xVals;
+   const float *yVals;
+   const float *xRecip;
+   const float *yRecip;
+   const void *data;
+   char type;
+   float scale;
+   float offset;
    int width;
+   int height;
    float defaultVal;
+   overlay_t *overlay;
+   tablecoef_t *coefs;
+   int xIndex;
+   int yIndex;
 } table_t;
 
 /*  This is a prototype for our tableLookup function.
@@ -25,8 +81,304 @@ float tableLookup(table_t *table, float x, float y);
 /*    This is a function used to get table values */
 float getData(table_t *table, int x, int y);
 
-/*    This is a function used to set table values. */
-void setData(table_t *table, int x, int y, float value);
+/*    This is a function used to set table values.
+   The new value goes in the table's overlay,
+   so it returns 0 if the table has no overlay or it is full. */
+int setData(table_t *table, int x, int y, float value);
+
+/*    This is a function used to make a table look up through cell coefficients.
+   coefs needs room for (width - 1) * (height - 1) cells,
+   and they are all built straight away. */
+void tableUseCoefs(table_t *table, tablecoef_t *coefs);
+
+/*    This is a function used to rebuild every cell coefficient of a table. */
+void tableBuildCoefs(table_t *table);
+
+/*    This is a function used to rebuild the coefficients of the
+   (up to four) cells that use the table value at x, y. */
+void tableRefreshCoefs(table_t *table, int x, int y);
+
+/*    This is a function used to fill in a table that is worked out from another.
+   dst has to be the same size as src and store its data as floats in data.
+   Each of its values becomes derive(value, x, y), where value is src's value
+   at that point and x and y are src's axis values there.
+   Any cell coefficients dst has are rebuilt too. */
+void tableDerive(table_t *dst, float *data, table_t *src, float (*derive)(float value, float x, float y));
+
+/*    This is a function used to turn a real value into a raw table value. */
+float tableToRaw(const table_t *table, float value);
+
+/*    This is a function used to put a tuned cell in an overlay
+   for a table that is width cells wide. It returns 0 if the overlay is full. */
+int overlaySet(overlay_t *overlay, int width, int x, int y, float value);
+
+/*    This is a function used to find a cell in an overlay.
+   It returns base if the cell has not been tuned. */
+float overlayGet(const overlay_t *overlay, int cell, float base);
+
+/*  This is a set of tables that get looked up together
+   at the same x and y, like the VE and SA tables each cycle.
+   A set can hold up to MAX_SET_TABLES tables. */
+#define MAX_SET_TABLES 8
+
+typedef struct tableset_t {
+   table_t **tables;
+   int count;
+} tableset_t;
+
+/*  This is a function used to look up every table in a set at once.
+   Each axis is only searched once for all of the tables that share it,
+   so adding more maps on the same axes costs just the blend.
+   results[i] gets the value from set->tables[i]. */
+void tableSetLookup(tableset_t *set, float x, float y, float *results);
+
+/* This is a helper function used to check whether an input value
+   falls in the bracket between vals[i] and vals[i + 1].
+   The first and last brackets are open ended so that we never
+   step off either end of the axis. */
+template <typename T>
+inline int tableInBracket(const T *vals, int size, T in, int i) {
+   return (i == 0 || in >= vals[i]) && (i == size - 2 || in < vals[i + 1]);
+}
+
+/* This is a helper function used to calculate
+   between which table axis values our desired input values fall.
+   The bracket from the last lookup is checked first, then its neighbours,
+   and only if the input jumped further do we do a binary search. */
+template <typename T>
+inline int tableFindIndex(const T *vals, int size, T in, int *cached) {
+   int i = *cached;
+   int lo, hi, mid;
+
+   if (tableInBracket(vals, size, in, i)) {
+      return i;
+   }
+
+   if (i + 1 <= size - 2 && tableInBracket(vals, size, in, i + 1)) {
+      i++;
+   }
+   else if (i > 0 && tableInBracket(vals, size, in, i - 1)) {
+      i--;
+   }
+   else {
+      // find the last axis value that is less than or equal to our input
+      lo = 0;
+      hi = size - 2;
+      while (lo < hi) {
+         mid = (lo + hi + 1) / 2;
+         if (in >= vals[mid])
+            lo = mid;
+         else
+            hi = mid - 1;
+      }
+      i = lo;
+   }
+
+   *cached = i;
+   return i;
+}
+
+/*  This is where an input value falls along one table axis:
+   the bracket it is in, and how far along that bracket it is from 0 to 1.
+   Tables that share an axis can share its axispos_t. */
+typedef struct axispos_t {
+   int index;
+   float weight;
+} axispos_t;
+
+/*  This is a function used to find where an input value falls on an axis.
+   recip is the axis's list of segment reciprocals, or NULL to divide instead.
+   Inputs past either end of the axis are clamped to the end
+   instead of extrapolated. The clamps are conditional selects, not branches. */
+inline axispos_t axisPosition(const float *vals, const float *recip, int size, float in, int *cached) {
+   axispos_t pos;
+   float lo, hi;
+
+   lo = vals[0];
+   hi = vals[size - 1];
+   in = in < hi ? in : hi;
+   in = in > lo ? in : lo;
+
+   pos.index = tableFindIndex(vals, size, in, cached);
+   if (recip)
+      pos.weight = (in - vals[pos.index]) * recip[pos.index];
+   else
+      pos.weight = (in - vals[pos.index]) / (vals[pos.index + 1] - vals[pos.index]);
+   return pos;
+}
+
+/*  This is a helper function used to read the four raw values
+   around a cell, whatever type they are stored as. */
+template <typename S>
+inline void tableCorners(const void *data, int cell, int width, float *c) {
+   const S *p = (const S *)data + cell;
+   c[0] = p[0];
+   c[1] = p[1];
+   c[2] = p[width];
+   c[3] = p[width + 1];
+}
+
+/*  This is a function used to read the four raw values around a cell,
+   including any tuned ones.
+   The overlay is only searched if one of the two rows has a tuned cell. */
+inline void tableRawCorners(const table_t *table, int width, int xIndex, int yIndex, float *c) {
+   int cell = yIndex * width + xIndex;
+   const overlay_t *overlay = table->overlay;
+
+   switch (table->type) {
+   case TABLE_UINT8:
+      tableCorners<uint8_t>(table->data, cell, width, c);
+      break;
+   case TABLE_INT16:
+      tableCorners<int16_t>(table->data, cell, width, c);
+      break;
+   default:
+      tableCorners<float>(table->data, cell, width, c);
+      break;
+   }
+
+   if (overlay && (overlay->rows & (OVERLAY_ROW(yIndex) | OVERLAY_ROW(yIndex + 1)))) {
+      c[0] = overlayGet(overlay, cell, c[0]);
+      c[1] = overlayGet(overlay, cell + 1, c[1]);
+      c[2] = overlayGet(overlay, cell + width, c[2]);
+      c[3] = overlayGet(overlay, cell + width + 1, c[3]);
+   }
+}
+
+/*  This is a function used to blend the four table values around
+   an x and y axis position.
+   The blend is done on raw values, so narrow tables only
+   apply their scale and offset once at the end.
+   A table with cell coefficients needs just three multiply-adds instead. */
+inline float tableBlend(const table_t *table, int width, axispos_t x, axispos_t y) {
+   float c[4];
+   float top, bottom, value;
+   const tablecoef_t *k;
+
+   if (table->coefs) {
+      k = table->coefs + y.index * (width - 1) + x.index;
+      return k->a + k->c * y.weight + x.weight * (k->b + k->d * y.weight);
+   }
+
+   tableRawCorners(table, width, x.index, y.index, c);
+
+   top = c[0] + (c[1] - c[0]) * x.weight;
+   bottom = c[2] + (c[3] - c[2]) * x.weight;
+   value = top + (bottom - top) * y.weight;
+
+   if (table->type != TABLE_FLOAT) {
+      value = value * table->scale + table->offset;
+   }
+   return value;
+}
+
+/*  This is the bilinear interpolation shared by tableLookup and Table.
+   The width and height are passed in separately so that Table can
+   give the compiler its dimensions as constants.
+   Below the start of the x axis the table gives its default value. */
+inline float tableInterpolate(table_t *table, int width, int height, float x, float y) {
+   if (x < table->xVals[0]) {
+      return table->defaultVal;
+   }
+
+   return tableBlend(table, width,
+      axisPosition(table->xVals, table->xRecip, width, x, &table->xIndex),
+      axisPosition(table->yVals, table->yRecip, height, y, &table->yIndex));
+}
+
+/*  This is a helper function used to check at compile time
+   that every value in an axis is bigger than the one before it. */
+template <typename T, int N>
+constexpr bool axisAscending(const T (&vals)[N], int i = 1) {
+   return i >= N || (vals[i - 1] < vals[i] && axisAscending(vals, i + 1));
+}
+
+/*  This tells Table which data types table_t knows how to store,
+   and which TABLE_ type goes with each of them. */
+template <typename T> struct tableType { static const bool supported = false; static const char code = -1; };
+template <> struct tableType<float> { static const bool supported = true; static const char code = TABLE_FLOAT; };
+template <> struct tableType<uint8_t> { static const bool supported = true; static const char code = TABLE_UINT8; };
+template <> struct tableType<int16_t> { static const bool supported = true; static const char code = TABLE_INT16; };
+
+/*  This is a table whose dimensions are part of its type.
+   It is still a table_t, so everything that takes a table_t works on it,
+   but it can only be built from axis and data arrays of the right size,
+   and its lookup knows W and H at compile time.
+   T is the type the data is stored as. The axes are always floats.
+   Check its axes with axisAscending when you build it, like this:
+      constexpr float xAxis[] = {...};
+      static_assert(axisAscending(xAxis), "xAxis must be increasing");
+      Table<16, 16, int16_t> myTable(xAxis, yAxis, data, defaultVal, 0.1f);
+   It can also be given the reciprocals of each axis segment,
+   like the ones TuneCompiler.py writes into tunedata.h.
+   The scale and offset are ignored for float data. */
+template <int W, int H, typename T = float>
+struct Table : table_t {
+   static_assert(W >= 2 && H >= 2, "a table needs at least two values on each axis");
+   static_assert(tableType<T>::supported, "table_t cannot store this data type");
+
+   constexpr Table(const float (&x)[W], const float (&y)[H], const T (&data)[H][W], float defaultVal,
+                   float scale = 1, float offset = 0, overlay_t *overlay = 0)
+      : table_t{x, y, 0, 0, &data[0][0], tableType<T>::code, scale, offset, W, H, defaultVal, overlay, 0, 0, 0} {}
+
+   constexpr Table(const float (&x)[W], const float (&y)[H], const float (&xRecip)[W - 1], const float (&yRecip)[H - 1],
+                   const T (&data)[H][W], float defaultVal, float scale = 1, float offset = 0, overlay_t *overlay = 0)
+      : table_t{x, y, xRecip, yRecip, &data[0][0], tableType<T>::code, scale, offset, W, H, defaultVal, overlay, 0, 0, 0} {}
+
+   /*    This is the main function used to access table data. */
+   float lookup(float x, float y) {
+      return tableInterpolate(this, W, H, x, y);
+   }
+};
+
+/*  Fixed point values are stored in Q16.16 format:
+   16 integer bits and 16 fractional bits, so 1.0 is 65536.
+   The Due has no FPU, so this lets lookups run on integer math only. */
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE ((fixed_t)1 << FIXED_SHIFT)
+
+/*  Interpolation weights are kept in Q2.30 so that rounding them
+   does not show up in the result.
+   Segment reciprocals are 2^(FIXED_SHIFT + WEIGHT_SHIFT) / width,
+   so (x - x_1) * recip >> FIXED_SHIFT is the weight of x_2.
+   This needs every axis segment to be wider than 0.5. */
+#define WEIGHT_SHIFT 30
+
+#define floatToFixed(f) ((fixed_t)((f) * FIXED_ONE + ((f) >= 0 ? 0.5f : -0.5f)))
+#define fixedToFloat(q) ((float)(q) * (1.0f / FIXED_ONE))
+
+/*  This is the fixed point version of the table struct.
+   It is built from a table_t at startup by tableToFixed,
+   and also keeps a reciprocal of each axis segment width
+   so that lookups never have to divide.
+   All of the arrays are allocated by the caller. */
+typedef struct tablefx_t {
+   fixed_t *xVals;
+   fixed_t *yVals;
+   fixed_t *data;
+   int32_t *xRecip;
+   int32_t *yRecip;
+   int width;
+   int height;
+   fixed_t defaultVal;
+   int xIndex;
+   int yIndex;
+} tablefx_t;
+
+/*  This is a function used to fill a tablefx_t from a table_t.
+   It returns 0 if the table does not fit in Q16.16
+   or has an axis segment that is 0.5 or narrower. */
+int tableToFixed(table_t *src, tablefx_t *dst);
+
+/*  This is the fixed point version of tableLookup.
+   Unlike tableLookup it clamps x and y to the ends of each axis.
+   Inside the axes it stays within FIXED_ERROR_BOUND of the float result
+   for the VE and SA tables in tuning.h. */
+#define FIXED_ERROR_BOUND 0.0001f
+
+fixed_t tableLookupFixed(tablefx_t *table, fixed_t x, fixed_t y);
 
 
 #endif
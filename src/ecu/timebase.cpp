@@ -0,0 +1,14 @@
+//timebase.cpp
+#include "timebase.h"
+
+volatile uint32_t timebaseWraps = 0;
+volatile uint32_t timebaseLast = 0;
+
+/*    This is a function used to start TICK_TIMER capturing edges of pin. */
+void timebaseStart(uint32_t pin, uint32_t mode) {
+   TICK_TIMER.startCapture(pin, mode);
+
+   // RC only compares in capture mode, so it can mark half way round
+   TICK_CHANNEL::channel()->TC_RC = TIMEBASE_HALF;
+   TICK_CHANNEL::channel()->TC_IER = TIMEBASE_STATUS;
+}
@@ -0,0 +1,105 @@
+//timebase.h
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+#include <DueTimer.h>
+#include "units.h"
+
+/*  The timebase counts on TICK_TIMER, which runs freely in capture mode
+   and also latches the tach edges as they happen. Its 32 bit counter
+   wraps about every 27 minutes, so the wraps are counted in software
+   to make a 64 bit time that does not wrap. */
+#define TICK_TIMER_NUMBER 0
+#define TICK_TIMER Timer0
+#define TICK_CHANNEL DueTimerChannel<TICK_TIMER_NUMBER>
+
+/*  These are the TICK_TIMER interrupts that keep the wraps counted:
+   one as it wraps, and one half way round, at TIMEBASE_HALF.
+   TICK_TIMER's handler has to call timebaseNow() on either. */
+#define TIMEBASE_STATUS (TC_SR_COVFS | TC_SR_CPCS)
+#define TIMEBASE_HALF 0x80000000u
+
+/*  This is a point in time, in ticks since the timebase started.
+   At 64 bits it never wraps, and taking one from another
+   gives the ticks_t in between, which is all the math ever needs. */
+typedef struct stamp_t {
+   int64_t raw;
+
+   constexpr stamp_t() : raw(0) {}
+   constexpr explicit stamp_t(int64_t raw) : raw(raw) {}
+   constexpr stamp_t(const stamp_t &s) = default;
+   stamp_t(const volatile stamp_t &s) : raw(s.raw) {}
+   stamp_t &operator=(stamp_t s) { raw = s.raw; return *this; }
+   void operator=(stamp_t s) volatile { raw = s.raw; }
+} stamp_t;
+
+constexpr stamp_t operator+(stamp_t s, ticks_t t) { return stamp_t(s.raw + t.raw); }
+constexpr stamp_t operator-(stamp_t s, ticks_t t) { return stamp_t(s.raw - t.raw); }
+constexpr ticks_t operator-(stamp_t a, stamp_t b) { return ticks_t(unitClamp(a.raw - b.raw)); }
+constexpr bool operator==(stamp_t a, stamp_t b) { return a.raw == b.raw; }
+constexpr bool operator!=(stamp_t a, stamp_t b) { return a.raw != b.raw; }
+constexpr bool operator<(stamp_t a, stamp_t b) { return a.raw < b.raw; }
+constexpr bool operator>(stamp_t a, stamp_t b) { return a.raw > b.raw; }
+constexpr bool operator<=(stamp_t a, stamp_t b) { return a.raw <= b.raw; }
+constexpr bool operator>=(stamp_t a, stamp_t b) { return a.raw >= b.raw; }
+
+extern volatile uint32_t timebaseWraps;   // how many times the counter has wrapped
+extern volatile uint32_t timebaseLast;    // the counter the last time it was read
+
+/*    This is a function used to start TICK_TIMER capturing edges of pin,
+   with the interrupts that keep the wraps counted. */
+void timebaseStart(uint32_t pin, uint32_t mode);
+
+/*    This is a function used to get the current time.
+   It is a few instructions, so it is fine to use in ISRs.
+   Wraps are noticed when it is called, so it has to be called
+   less than a whole wrap apart. The TIMEBASE_STATUS interrupts call it
+   every half wrap, so that holds even when nothing else calls it. */
+inline stamp_t timebaseNow() {
+   uint32_t primask = __get_PRIMASK();
+   uint32_t low, wraps;
+
+   __disable_irq();   // so an ISR in the middle of this cannot count the same wrap twice
+   low = TICK_CHANNEL::counter();
+   if (low < timebaseLast)
+      timebaseWraps++;
+   timebaseLast = low;
+   wraps = timebaseWraps;
+   __set_PRIMASK(primask);
+   return stamp_t((int64_t)((uint64_t)wraps << 32 | low));
+}
+
+/*    This is a function used to turn a counter value from the recent past
+   (less than half a wrap ago) into a full time. */
+inline stamp_t timebaseExtend(uint32_t low) {
+   stamp_t now = timebaseNow();
+   return now - ticks_t((int32_t)((uint32_t)now.raw - low));
+}
+
+/*    This is a function used to get the time TICK_TIMER latched
+   on the last tach edge, which is when the edge really happened
+   and not when its interrupt got around to running. */
+inline stamp_t timebaseCaptured() {
+   return timebaseExtend(TICK_CHANNEL::capture());
+}
+
+/*    This is a function used to get the time timer N's counter passed
+   compare, like an edge the timer drove on its pin by itself.
+   The counter has to still be running, so it says how long ago that was,
+   which makes it right however late the compare's ISR gets to run.
+   Both counters count at CAPTURE_FREQUENCY, and are read together. */
+template <int N>
+inline stamp_t timebaseCompared(uint32_t compare) {
+   uint32_t primask = __get_PRIMASK();
+   uint32_t count;
+   stamp_t now;
+
+   __disable_irq();   // so an ISR cannot come between the two reads
+   count = DueTimerChannel<N>::counter();
+   now = timebaseNow();
+   __set_PRIMASK(primask);
+   return now - ticks_t((int32_t)(count - compare));
+}
+
+#endif
@@ -0,0 +1,67 @@
+//tunedata.h
+//Generated by SMVTuner/TuneCompiler.py from tuningve.smv and tuningsa.smv.
+//Do not edit this file by hand, change the tune and run TuneCompiler.py again.
+#ifndef TUNEDATA_H
+#define TUNEDATA_H
+
+#include <stdint.h>
+
+/*  This is a hash of the table data below,
+   so you can tell which tune the firmware was built with. */
+#define TUNE_HASH 0xe8454cd6UL
+
+constexpr float yAxisVE[] = {30.1, 35, 40, 45, 50, 55, 60, 65, 70, 75, 80, 85, 90, 95, 98, 100};
+constexpr float xAxisVE[] = {1000, 1050, 1101, 1401, 2001, 2601, 3101, 3700, 4300, 4900, 5400, 6000, 6500, 7000, 7200, 7500};
+constexpr float yRecipVE[] = {0.204081633, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.333333333, 0.5};
+constexpr float xRecipVE[] = {0.02, 0.0196078431, 0.00333333333, 0.00166666667, 0.00166666667, 0.002, 0.00166944908, 0.00166666667, 0.00166666667, 0.002, 0.00166666667, 0.002, 0.002, 0.005, 0.00333333333};
+const uint8_t dataVE[][16] = {
+   {28, 30, 30, 37, 36, 36, 36, 36, 35, 35, 35, 35, 34, 34, 34, 34},
+   {31, 31, 31, 38, 38, 38, 38, 38, 38, 38, 38, 38, 38, 38, 38, 38},
+   {31, 31, 31, 39, 39, 39, 40, 40, 40, 41, 41, 41, 41, 42, 42, 42},
+   {32, 32, 32, 40, 40, 41, 41, 42, 43, 43, 44, 44, 45, 45, 46, 46},
+   {32, 33, 33, 41, 42, 42, 43, 44, 45, 46, 47, 48, 48, 49, 49, 50},
+   {33, 33, 34, 39, 40, 41, 45, 46, 48, 49, 50, 51, 52, 53, 53, 54},
+   {33, 34, 35, 31, 32, 34, 47, 48, 50, 51, 53, 54, 55, 57, 57, 58},
+   {34, 35, 36, 32, 33, 35, 49, 51, 52, 54, 56, 57, 59, 60, 61, 62},
+   {35, 36, 37, 33, 35, 37, 51, 53, 55, 57, 59, 61, 62, 64, 65, 66},
+   {35, 36, 38, 34, 36, 38, 52, 55, 57, 60, 62, 64, 66, 68, 69, 70},
+   {36, 37, 38, 35, 37, 40, 54, 57, 60, 62, 65, 67, 70, 72, 73, 74},
+   {36, 38, 37, 38, 43, 46, 48, 51, 54, 57, 68, 71, 73, 76, 76, 78},
+   {68, 69, 68, 74, 82, 85, 86, 86, 89, 92, 91, 92, 89, 87, 91, 93},
+   {68, 70, 69, 75, 81, 83, 84, 84, 87, 91, 90, 91, 88, 87, 91, 93},
+   {69, 72, 75, 79, 82, 84, 86, 86, 88, 92, 91, 93, 90, 89, 94, 95},
+   {69, 72, 76, 80, 83, 85, 86, 87, 90, 93, 92, 94, 92, 91, 95, 97}
+};
+const float scaleVE = 1;
+const float defaultVE = -1;
+static_assert(sizeof(dataVE) / sizeof(dataVE[0]) == sizeof(yAxisVE) / sizeof(yAxisVE[0]), "dataVE needs one row per y axis value");
+static_assert(sizeof(dataVE[0]) / sizeof(dataVE[0][0]) == sizeof(xAxisVE) / sizeof(xAxisVE[0]), "dataVE needs one column per x axis value");
+static_assert(sizeof(yRecipVE) / sizeof(yRecipVE[0]) == sizeof(yAxisVE) / sizeof(yAxisVE[0]) - 1, "yRecipVE needs one value per y axis segment");
+static_assert(sizeof(xRecipVE) / sizeof(xRecipVE[0]) == sizeof(xAxisVE) / sizeof(xAxisVE[0]) - 1, "xRecipVE needs one value per x axis segment");
+
+constexpr float yAxisSA[] = {20.1, 25, 30, 35, 40, 45, 50, 60, 70, 80, 90, 100};
+constexpr float xAxisSA[] = {1000, 1001, 1200, 1500, 2000, 2600, 3100, 3700, 4300, 4900, 5400, 6000};
+constexpr float yRecipSA[] = {0.204081633, 0.2, 0.2, 0.2, 0.2, 0.2, 0.1, 0.1, 0.1, 0.1, 0.1};
+constexpr float xRecipSA[] = {1, 0.00502512563, 0.00333333333, 0.002, 0.00166666667, 0.002, 0.00166666667, 0.00166666667, 0.00166666667, 0.002, 0.00166666667};
+const int16_t dataSA[][12] = {
+   {186, 192, 200, 208, 224, 243, 253, 270, 287, 295, 302, 310},
+   {185, 190, 199, 207, 223, 242, 252, 269, 286, 293, 300, 370},
+   {183, 189, 197, 206, 222, 241, 251, 268, 285, 292, 298, 305},
+   {182, 187, 196, 204, 220, 239, 249, 266, 283, 290, 295, 302},
+   {180, 186, 194, 203, 219, 238, 248, 265, 282, 288, 293, 299},
+   {179, 184, 193, 201, 217, 236, 247, 264, 281, 286, 291, 297},
+   {177, 183, 191, 200, 216, 235, 245, 262, 280, 285, 289, 294},
+   {174, 180, 188, 197, 213, 232, 243, 260, 277, 281, 284, 289},
+   {178, 184, 192, 201, 217, 237, 247, 264, 288, 285, 287, 290},
+   {178, 184, 192, 201, 218, 237, 247, 265, 288, 290, 292, 294},
+   {175, 181, 189, 198, 215, 234, 245, 262, 286, 287, 287, 288},
+   {172, 178, 187, 195, 212, 231, 242, 259, 283, 283, 283, 283}
+};
+const float scaleSA = 0.1;
+const float defaultSA = 5;
+static_assert(sizeof(dataSA) / sizeof(dataSA[0]) == sizeof(yAxisSA) / sizeof(yAxisSA[0]), "dataSA needs one row per y axis value");
+static_assert(sizeof(dataSA[0]) / sizeof(dataSA[0][0]) == sizeof(xAxisSA) / sizeof(xAxisSA[0]), "dataSA needs one column per x axis value");
+static_assert(sizeof(yRecipSA) / sizeof(yRecipSA[0]) == sizeof(yAxisSA) / sizeof(yAxisSA[0]) - 1, "yRecipSA needs one value per y axis segment");
+static_assert(sizeof(xRecipSA) / sizeof(xRecipSA[0]) == sizeof(xAxisSA) / sizeof(xAxisSA[0]) - 1, "xRecipSA needs one value per x axis segment");
+
+#endif
@@ -0,0 +1,106 @@
+//tuner.cpp
+#include "tuner.h"
+#include <string.h>
+
+/* This keeps the compiler from moving writes to the shadow overlay
+   past the write to tuner->state that hands it over. */
+#define TUNER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/* This is a helper function used to rebuild what is derived from one
+   table value: its cell coefficients, then its part of the grid. */
+static void tunerRefreshCell(tabletuner_t *tuner, int cell) {
+   int width = tuner->table->width;
+
+   tableRefreshCoefs(tuner->table, cell % width, cell / width);
+   if (tuner->grid) {
+      denseRefresh(tuner->grid, cell % width, cell / width);
+   }
+}
+
+/* This is a helper function used to rebuild the table's cell coefficients
+   and grid after a publish. Only the parts around a value that was tuned
+   before or after the publish can have changed, unless the data was replaced. */
+static void tunerRefresh(tabletuner_t *tuner, const overlay_t *old, int replaced) {
+   const overlay_t *live = tuner->table->overlay;
+   int i;
+
+   if (replaced) {
+      tableBuildCoefs(tuner->table);
+      if (tuner->grid) {
+         denseBuild(tuner->grid);
+      }
+      return;
+   }
+
+   for (i = 0; i < old->count; i++) {
+      tunerRefreshCell(tuner, old->cells[i]);
+   }
+   for (i = 0; i < live->count; i++) {
+      tunerRefreshCell(tuner, live->cells[i]);
+   }
+}
+
+/*    This is a function used to hook a tuner up to its table. */
+void tunerInit(tabletuner_t *tuner, table_t *table) {
+   memset(tuner->buffers, 0, sizeof(tuner->buffers));
+   tuner->table = table;
+   tuner->shadow = &tuner->buffers[1];
+   tuner->stagedData = table->data;
+   tuner->grid = 0;
+   tuner->version = 0;
+   tuner->state = TUNER_IDLE;
+   table->overlay = &tuner->buffers[0];
+   tableBuildCoefs(table);
+}
+
+/*    This is a function used to start staging changes. */
+int tunerBegin(tabletuner_t *tuner) {
+   if (tuner->state == TUNER_READY) {
+      return 0;
+   }
+
+   // loop() never reads the shadow, so it is safe to rewrite it here
+   memcpy(tuner->shadow, tuner->table->overlay, sizeof(overlay_t));
+   tuner->stagedData = tuner->table->data;
+   tuner->state = TUNER_STAGING;
+   return 1;
+}
+
+/*    This is a function used to stage a change to one cell. */
+int tunerSet(tabletuner_t *tuner, int x, int y, float value) {
+   return overlaySet(tuner->shadow, tuner->table->width, x, y, tableToRaw(tuner->table, value));
+}
+
+/*    This is a function used to stage a whole new table. */
+void tunerReplace(tabletuner_t *tuner, const void *data) {
+   memset(tuner->shadow, 0, sizeof(overlay_t));
+   tuner->stagedData = data;
+}
+
+/*    This is a function used to mark the staged changes as finished. */
+void tunerCommit(tabletuner_t *tuner) {
+   TUNER_BARRIER();
+   tuner->state = TUNER_READY;
+}
+
+/*    This is a function used to swap the staged changes into the table. */
+int tunerPublish(tabletuner_t *tuner) {
+   overlay_t *live;
+   int replaced;
+
+   if (tuner->state != TUNER_READY) {
+      return 0;
+   }
+
+   TUNER_BARRIER();
+   live = tuner->table->overlay;
+   replaced = tuner->table->data != tuner->stagedData;
+   tuner->table->data = tuner->stagedData;
+   tuner->table->overlay = tuner->shadow;
+   tuner->shadow = live;
+   tunerRefresh(tuner, live, replaced);
+   tuner->version++;
+   TUNER_BARRIER();
+   tuner->state = TUNER_IDLE;
+   return 1;
+}
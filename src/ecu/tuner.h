@@ -0,0 +1,63 @@
+//tuner.h
+#ifndef TUNER_H
+#define TUNER_H
+
+#include "table.h"
+#include "densegrid.h"
+
+#define TUNER_IDLE 0       // nothing staged, tunerBegin can be called
+#define TUNER_STAGING 1    // changes are being made to the shadow overlay
+#define TUNER_READY 2      // changes are waiting for tunerPublish
+
+/*  This is the table tuner struct.
+   It lets a table be changed while the engine is running
+   without loop() ever seeing a half-changed table.
+   Changes are staged in the shadow overlay while lookups keep using
+   the live one, and tunerPublish swaps them in all at once
+   at the start of the next cycle.
+   Nothing here waits on anything, so it is safe to tune from an ISR.
+   grid is an optional dense grid over the table,
+   which gets refreshed along with the table when changes are published.
+   Anything else worked out from the table can compare version
+   with the one it was worked out from to see if it is out of date. */
+typedef struct tabletuner_t {
+   table_t *table;
+   overlay_t buffers[2];
+   overlay_t *shadow;         // the overlay that changes are staged in
+   const void *stagedData;    // data to swap in with the shadow overlay
+   densegrid_t *grid;
+   unsigned long version;     // goes up every time changes are published
+   volatile char state;
+} tabletuner_t;
+
+/*    This is a function used to hook a tuner up to its table.
+   The table's overlay is replaced by one of the tuner's buffers. */
+void tunerInit(tabletuner_t *tuner, table_t *table);
+
+/*    This is a function used to start staging changes.
+   The shadow starts out as a copy of the live overlay.
+   It returns 0 if the last changes have not been published yet. */
+int tunerBegin(tabletuner_t *tuner);
+
+/*    This is a function used to stage a change to one cell.
+   It returns 0 if the shadow overlay is full. */
+int tunerSet(tabletuner_t *tuner, int x, int y, float value);
+
+/*    This is a function used to stage a whole new table.
+   The new data has to be stored as the same type as the old data.
+   It drops any tuned cells, so tunerSet can be used after it
+   to stage changes on top of the new data. */
+void tunerReplace(tabletuner_t *tuner, const void *data);
+
+/*    This is a function used to mark the staged changes as finished. */
+void tunerCommit(tabletuner_t *tuner);
+
+/*    This is a function used to swap the staged changes into the table.
+   It must only be called from the same place the table is looked up,
+   in between lookups, which for the ECU is the start of a cycle in loop().
+   If the table has cell coefficients or a grid, the parts of them
+   that changed are rebuilt here.
+   It returns 1 if the table changed. */
+int tunerPublish(tabletuner_t *tuner);
+
+#endif
@@ -0,0 +1,69 @@
+//uniformtable.h
+#ifndef UNIFORMTABLE_H
+#define UNIFORMTABLE_H
+
+#include "table.h"
+
+/*  This is a table with evenly spaced axes.
+   The axis values are not stored at all: x starts at X0 and goes up by DX
+   for each column, and y starts at Y0 and goes up by DY for each row.
+   That means finding the cell is just a subtract and a multiply,
+   instead of searching through the axis values like table_t does.
+   The origins and steps are template arguments, so they are known
+   at compile time and have to be whole numbers.
+   Like tableLookup it gives defaultVal below X0 and clamps everywhere else.
+   Use it like this:
+      UniformTable<14, 15, 1000, 500, 30, 5> uniformVE;
+      uniformVE.resample(&VETable);
+      volEff = uniformVE.lookup(rpm, mapVal); */
+template <int W, int H, int X0, int DX, int Y0, int DY>
+struct UniformTable {
+   float data[H][W];
+   float defaultVal;
+
+   /*    This is the main function used to access table data. */
+   float lookup(float x, float y) const {
+      float xPos, yPos;
+      float xWeight, yWeight;
+      int xIndex, yIndex;
+
+      if (x < X0) {
+         return defaultVal;
+      }
+
+      //Find which cell we are in and how far along it we are.
+      //The reciprocals of the steps are folded by the compiler.
+      //Past the ends of the grid we clamp instead of extrapolating.
+      xPos = (x - X0) * (1.0f / DX);
+      yPos = (y - Y0) * (1.0f / DY);
+      xPos = xPos < W - 1 ? xPos : W - 1;
+      yPos = yPos < H - 1 ? yPos : H - 1;
+      yPos = yPos > 0 ? yPos : 0;
+      xIndex = (int)xPos;
+      yIndex = (int)yPos;
+      if (xIndex > W - 2) xIndex = W - 2;
+      if (yIndex > H - 2) yIndex = H - 2;
+      xWeight = xPos - xIndex;
+      yWeight = yPos - yIndex;
+
+      //Return a bilinear interpolation of the data.
+      return
+         (data[yIndex][xIndex] * (1 - xWeight) + data[yIndex][xIndex + 1] * xWeight) * (1 - yWeight) +
+         (data[yIndex + 1][xIndex] * (1 - xWeight) + data[yIndex + 1][xIndex + 1] * xWeight) * yWeight;
+   }
+
+   /*    This is a function used to fill this table from a table_t
+      by looking up the source table at each of our grid points. */
+   void resample(table_t *src) {
+      int x, y;
+
+      for (y = 0; y < H; y++) {
+         for (x = 0; x < W; x++) {
+            data[y][x] = tableLookup(src, X0 + x * DX, Y0 + y * DY);
+         }
+      }
+      defaultVal = src->defaultVal;
+   }
+};
+
+#endif
@@ -0,0 +1,137 @@
+//units.h
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <DueTimer.h>
+
+/*  Time is counted in ticks of the timebase (see timebase.h).
+   There are TICKS_PER_SECOND of them in a second. */
+#define TICKS_PER_SECOND ((long)CAPTURE_FREQUENCY)
+
+/*  This is microseconds per tick, in Q16, so turning ticks into
+   microseconds is a multiply and not a divide. */
+#define MICROS_PER_TICK ((int32_t)(65536.0 * 1000000 / TICKS_PER_SECOND + 0.5))
+
+/*  Crank angles are counted in 1/64 of a degree,
+   which is plenty for timing and still fits many turns in 32 bits. */
+#define ANGLE_SHIFT 6
+#define ANGLE_ONE ((int32_t)1 << ANGLE_SHIFT)
+
+/*  Engine speeds are in 1/64 degrees per tick, in Q8.24 format,
+   so angles and times can be turned into each other with one multiply
+   one way and one divide the other way. */
+#define SPEED_SHIFT 24
+
+/*  This is a whole number of some unit, like ticks or 1/64 degrees.
+   Each unit is its own type, so that an angle cannot be used as a time
+   by mistake, and they only add, subtract and compare with their own kind.
+   Adding and subtracting wrap around instead of overflowing, so the
+   difference between two times is right even after the tick count wraps.
+   They can be volatile, so that ISRs and loop() can share them. */
+template <typename U>
+struct Unit {
+   int32_t raw;
+
+   constexpr Unit() : raw(0) {}
+   constexpr explicit Unit(int32_t raw) : raw(raw) {}
+   constexpr Unit(const Unit &u) = default;
+   Unit(const volatile Unit &u) : raw(u.raw) {}
+   Unit &operator=(Unit u) { raw = u.raw; return *this; }
+   void operator=(Unit u) volatile { raw = u.raw; }
+   Unit &operator+=(Unit u) { raw = (int32_t)((uint32_t)raw + (uint32_t)u.raw); return *this; }
+   Unit &operator-=(Unit u) { raw = (int32_t)((uint32_t)raw - (uint32_t)u.raw); return *this; }
+};
+
+template <typename U>
+constexpr Unit<U> operator+(Unit<U> a, Unit<U> b) { return Unit<U>((int32_t)((uint32_t)a.raw + (uint32_t)b.raw)); }
+template <typename U>
+constexpr Unit<U> operator-(Unit<U> a, Unit<U> b) { return Unit<U>((int32_t)((uint32_t)a.raw - (uint32_t)b.raw)); }
+template <typename U>
+constexpr Unit<U> operator-(Unit<U> a) { return Unit<U>((int32_t)(0 - (uint32_t)a.raw)); }
+template <typename U>
+constexpr Unit<U> operator*(Unit<U> a, int32_t n) { return Unit<U>((int32_t)((uint32_t)a.raw * (uint32_t)n)); }
+template <typename U>
+constexpr Unit<U> operator*(int32_t n, Unit<U> a) { return a * n; }
+template <typename U>
+constexpr Unit<U> operator/(Unit<U> a, int32_t n) { return Unit<U>(a.raw / n); }
+template <typename U>
+constexpr bool operator==(Unit<U> a, Unit<U> b) { return a.raw == b.raw; }
+template <typename U>
+constexpr bool operator!=(Unit<U> a, Unit<U> b) { return a.raw != b.raw; }
+template <typename U>
+constexpr bool operator<(Unit<U> a, Unit<U> b) { return a.raw < b.raw; }
+template <typename U>
+constexpr bool operator>(Unit<U> a, Unit<U> b) { return a.raw > b.raw; }
+template <typename U>
+constexpr bool operator<=(Unit<U> a, Unit<U> b) { return a.raw <= b.raw; }
+template <typename U>
+constexpr bool operator>=(Unit<U> a, Unit<U> b) { return a.raw >= b.raw; }
+
+struct angleUnit {};
+struct tickUnit {};
+struct speedUnit {};
+
+typedef Unit<angleUnit> angle_t;    // crank angle in 1/64 degree
+typedef Unit<tickUnit> ticks_t;     // time in ticks
+typedef Unit<speedUnit> speed_t;    // 1/64 degrees per tick in Q8.24
+
+/* This is a helper function used to keep a 64 bit result in 32 bits,
+   by pinning it to the biggest or smallest 32 bit number. */
+constexpr int32_t unitClamp(int64_t v) {
+   return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+}
+
+/*    This is a function used to make an angle from degrees, rounded to 1/64.
+   With a constant it is worked out at compile time. */
+constexpr angle_t angleDegrees(float degrees) {
+   return angle_t((int32_t)(degrees * ANGLE_ONE + (degrees >= 0 ? 0.5f : -0.5f)));
+}
+
+/*    This is a function used to turn an angle back into degrees, for printing. */
+inline float angleToDegrees(angle_t angle) {
+   return angle.raw * (1.0f / ANGLE_ONE);
+}
+
+/*    This is a function used to make a time from microseconds, rounded to a tick.
+   With a constant it is worked out at compile time. */
+constexpr ticks_t ticksMicros(float us) {
+   return ticks_t((int32_t)(us * (TICKS_PER_SECOND / 1000000.0f) + (us >= 0 ? 0.5f : -0.5f)));
+}
+
+/*    This is a function used to turn a time into microseconds, for printing. */
+inline long ticksToMicros(ticks_t ticks) {
+   return (long)(((int64_t)ticks.raw * MICROS_PER_TICK) >> 16);
+}
+
+/*    This is a function used to find the speed that covers an angle in a time.
+   It gives 0 if no time has gone by. */
+inline speed_t speedFrom(angle_t angle, ticks_t time) {
+   if (time.raw <= 0)
+      return speed_t(0);
+   return speed_t(unitClamp(((int64_t)angle.raw << SPEED_SHIFT) / time.raw));
+}
+
+/*    This is a function used to turn a speed into rpm, for the tables. */
+inline float speedToRpm(speed_t speed) {
+   // 1/64 degrees per tick -> degrees per second -> turns per minute
+   return speed.raw * ((float)TICKS_PER_SECOND / ((float)(1L << SPEED_SHIFT) * ANGLE_ONE * 6));
+}
+
+/*    This is a function used to find how far the crank turns in a time.
+   It is a multiply and a shift, so it is cheap enough for an ISR. */
+inline angle_t ticksToAngle(ticks_t ticks, speed_t speed) {
+   return angle_t(unitClamp(((int64_t)ticks.raw * speed.raw) >> SPEED_SHIFT));
+}
+
+/*    This is a function used to find how long the crank takes to turn an angle.
+   It divides, so it should be done in loop() and not in an ISR.
+   If the crank is not turning it gives the longest time there is. */
+inline ticks_t angleToTicks(angle_t angle, speed_t speed) {
+   if (speed.raw <= 0)
+      return ticks_t(INT32_MAX);
+   return ticks_t(unitClamp(((int64_t)angle.raw << SPEED_SHIFT) / speed.raw));
+}
+
+#endif
@@ -0,0 +1,194 @@
+//tablebatch.cpp
+#include "tablebatch.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BATCH_LANES 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BATCH_LANES 4
+#endif
+
+/* This is a helper function used to look up one point in plain C.
+   It matches tableLookup, except that it leaves the cached brackets alone. */
+static float batchLookup(const table_t *table, float x, float y) {
+   int xCache = table->xIndex;
+   int yCache = table->yIndex;
+
+   if (x < table->xVals[0]) {
+      return table->defaultVal;
+   }
+
+   return tableBlend(table, table->width,
+      axisPosition(table->xVals, table->xRecip, table->width, x, &xCache),
+      axisPosition(table->yVals, table->yRecip, table->height, y, &yCache));
+}
+
+#ifdef BATCH_LANES
+
+/*  This is how far a group of points has got in between the vector steps.
+   Finding brackets and blending is done one lane per point,
+   but reading the corners stays scalar since every point
+   can land in a different cell. */
+typedef struct batchlanes_t {
+   int xIndex[BATCH_LANES];
+   int yIndex[BATCH_LANES];
+   float x1[BATCH_LANES];     // start of the x bracket
+   float xStep[BATCH_LANES];  // x bracket reciprocal, or its width if there is none
+   float y1[BATCH_LANES];
+   float yStep[BATCH_LANES];
+   float c00[BATCH_LANES];
+   float c10[BATCH_LANES];
+   float c01[BATCH_LANES];
+   float c11[BATCH_LANES];
+} batchlanes_t;
+
+/* This is a helper function used to read the brackets and corners
+   of every lane once their indices are known. */
+static void batchCorners(const table_t *table, batchlanes_t *lanes) {
+   int lane, xIndex, yIndex;
+   float c[4];
+
+   for (lane = 0; lane < BATCH_LANES; lane++) {
+      xIndex = lanes->xIndex[lane];
+      yIndex = lanes->yIndex[lane];
+      lanes->x1[lane] = table->xVals[xIndex];
+      lanes->y1[lane] = table->yVals[yIndex];
+      lanes->xStep[lane] = table->xRecip ? table->xRecip[xIndex] : table->xVals[xIndex + 1] - table->xVals[xIndex];
+      lanes->yStep[lane] = table->yRecip ? table->yRecip[yIndex] : table->yVals[yIndex + 1] - table->yVals[yIndex];
+
+      tableRawCorners(table, table->width, xIndex, yIndex, c);
+      lanes->c00[lane] = c[0];
+      lanes->c10[lane] = c[1];
+      lanes->c01[lane] = c[2];
+      lanes->c11[lane] = c[3];
+   }
+}
+
+#endif
+
+#if defined(__AVX__)
+
+/* This is a helper function used to clamp eight inputs to an axis and
+   find their brackets, by counting the axis values each one is past.
+   It gives the same bracket as tableFindIndex without any branches. */
+static __m256 batchAxis(const float *vals, int size, __m256 in, int *index) {
+   __m256 count = _mm256_setzero_ps();
+   __m256 one = _mm256_set1_ps(1);
+   int i;
+
+   in = _mm256_min_ps(in, _mm256_set1_ps(vals[size - 1]));
+   in = _mm256_max_ps(in, _mm256_set1_ps(vals[0]));
+
+   for (i = 1; i < size - 1; i++) {
+      count = _mm256_add_ps(count, _mm256_and_ps(_mm256_cmp_ps(in, _mm256_set1_ps(vals[i]), _CMP_GE_OQ), one));
+   }
+   _mm256_storeu_si256((__m256i *)index, _mm256_cvttps_epi32(count));
+   return in;
+}
+
+/* This is a helper function used to look up eight points at once with AVX.
+   The blend does the same operations in the same order as tableBlend. */
+static void batchVector(const table_t *table, const float *xs, const float *ys, float *results) {
+   batchlanes_t lanes;
+   __m256 x = _mm256_loadu_ps(xs);
+   __m256 y = _mm256_loadu_ps(ys);
+   __m256 isDefault = _mm256_cmp_ps(x, _mm256_set1_ps(table->xVals[0]), _CMP_LT_OQ);
+   __m256 xWeight, yWeight, c00, c01, top, bottom, value;
+
+   x = batchAxis(table->xVals, table->width, x, lanes.xIndex);
+   y = batchAxis(table->yVals, table->height, y, lanes.yIndex);
+   batchCorners(table, &lanes);
+
+   xWeight = _mm256_sub_ps(x, _mm256_loadu_ps(lanes.x1));
+   yWeight = _mm256_sub_ps(y, _mm256_loadu_ps(lanes.y1));
+   xWeight = table->xRecip ? _mm256_mul_ps(xWeight, _mm256_loadu_ps(lanes.xStep))
+                           : _mm256_div_ps(xWeight, _mm256_loadu_ps(lanes.xStep));
+   yWeight = table->yRecip ? _mm256_mul_ps(yWeight, _mm256_loadu_ps(lanes.yStep))
+                           : _mm256_div_ps(yWeight, _mm256_loadu_ps(lanes.yStep));
+
+   c00 = _mm256_loadu_ps(lanes.c00);
+   c01 = _mm256_loadu_ps(lanes.c01);
+   top = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(lanes.c10), c00), xWeight));
+   bottom = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(lanes.c11), c01), xWeight));
+   value = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), yWeight));
+
+   if (table->type != TABLE_FLOAT) {
+      value = _mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(table->scale)), _mm256_set1_ps(table->offset));
+   }
+
+   _mm256_storeu_ps(results, _mm256_blendv_ps(value, _mm256_set1_ps(table->defaultVal), isDefault));
+}
+
+#elif defined(__SSE2__)
+
+/* This is a helper function used to clamp four inputs to an axis and
+   find their brackets, by counting the axis values each one is past.
+   It gives the same bracket as tableFindIndex without any branches. */
+static __m128 batchAxis(const float *vals, int size, __m128 in, int *index) {
+   __m128i count = _mm_setzero_si128();
+   int i;
+
+   in = _mm_min_ps(in, _mm_set1_ps(vals[size - 1]));
+   in = _mm_max_ps(in, _mm_set1_ps(vals[0]));
+
+   // a true compare is all ones, which is -1, so subtracting it counts up
+   for (i = 1; i < size - 1; i++) {
+      count = _mm_sub_epi32(count, _mm_castps_si128(_mm_cmpge_ps(in, _mm_set1_ps(vals[i]))));
+   }
+   _mm_storeu_si128((__m128i *)index, count);
+   return in;
+}
+
+/* This is a helper function used to look up four points at once with SSE2.
+   The blend does the same operations in the same order as tableBlend. */
+static void batchVector(const table_t *table, const float *xs, const float *ys, float *results) {
+   batchlanes_t lanes;
+   __m128 x = _mm_loadu_ps(xs);
+   __m128 y = _mm_loadu_ps(ys);
+   __m128 isDefault = _mm_cmplt_ps(x, _mm_set1_ps(table->xVals[0]));
+   __m128 xWeight, yWeight, c00, c01, top, bottom, value;
+
+   x = batchAxis(table->xVals, table->width, x, lanes.xIndex);
+   y = batchAxis(table->yVals, table->height, y, lanes.yIndex);
+   batchCorners(table, &lanes);
+
+   xWeight = _mm_sub_ps(x, _mm_loadu_ps(lanes.x1));
+   yWeight = _mm_sub_ps(y, _mm_loadu_ps(lanes.y1));
+   xWeight = table->xRecip ? _mm_mul_ps(xWeight, _mm_loadu_ps(lanes.xStep))
+                           : _mm_div_ps(xWeight, _mm_loadu_ps(lanes.xStep));
+   yWeight = table->yRecip ? _mm_mul_ps(yWeight, _mm_loadu_ps(lanes.yStep))
+                           : _mm_div_ps(yWeight, _mm_loadu_ps(lanes.yStep));
+
+   c00 = _mm_loadu_ps(lanes.c00);
+   c01 = _mm_loadu_ps(lanes.c01);
+   top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(lanes.c10), c00), xWeight));
+   bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(lanes.c11), c01), xWeight));
+   value = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), yWeight));
+
+   if (table->type != TABLE_FLOAT) {
+      value = _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(table->scale)), _mm_set1_ps(table->offset));
+   }
+
+   value = _mm_or_ps(_mm_andnot_ps(isDefault, value), _mm_and_ps(isDefault, _mm_set1_ps(table->defaultVal)));
+   _mm_storeu_ps(results, value);
+}
+
+#endif
+
+/*    This is a function used to look up a table at a lot of points at once. */
+void tableLookupBatch(table_t *table, const float *xs, const float *ys, float *results, int count) {
+   int i = 0;
+
+#ifdef BATCH_LANES
+   // tables with cell coefficients are blended by tableBlend
+   for (; !table->coefs && i + BATCH_LANES <= count; i += BATCH_LANES) {
+      batchVector(table, xs + i, ys + i, results + i);
+   }
+#endif
+
+   // whatever is left over goes one at a time
+   for (; i < count; i++) {
+      results[i] = batchLookup(table, xs[i], ys[i]);
+   }
+}
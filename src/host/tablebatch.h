@@ -0,0 +1,20 @@
+//tablebatch.h
+#ifndef TABLEBATCH_H
+#define TABLEBATCH_H
+
+#include "table.h"
+
+/*  This is only built on a PC, so it lives out of the sketch folder,
+   where the Arduino IDE would build it into the firmware too.
+   It still reads the tables through table.h like the firmware does. */
+
+/*  This is a function used to look up a table at a lot of points at once,
+   for replaying logged drives or sweeping a whole map on a PC.
+   results[i] is the same as tableLookup(table, xs[i], ys[i]) bit for bit,
+   as long as the compiler is not allowed to fuse multiplies and adds
+   (build with -ffp-contract=off), since the Due cannot fuse them either.
+   On x86 several points are done at a time with AVX or SSE2 when the
+   compiler has them turned on, and one at a time in plain C everywhere else. */
+void tableLookupBatch(table_t *table, const float *xs, const float *ys, float *results, int count);
+
+#endif
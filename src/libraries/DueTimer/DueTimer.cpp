@@ -40,6 +40,8 @@ const DueTimer::Timer DueTimer::Timers[NUM_TIMERS] = {
 	void (*DueTimer::callbacks[NUM_TIMERS])() = {};
 #endif
 double DueTimer::_frequency[NUM_TIMERS] = {-1,-1,-1,-1,-1,-1,-1,-1,-1};
+int DueTimer::_pulsePin[NUM_TIMERS] = {-1,-1,-1,-1,-1,-1,-1,-1,-1};
+uint8_t DueTimer::_tickDivisor[NUM_TIMERS] = {};
 
 /*
 	Initializing all timers, so you can use them like this: Timer0.start();
@@ -219,6 +221,8 @@ DueTimer& DueTimer::setFrequency(double frequency){
 	// in UP mode with automatic trigger on RC Compare
 	// and sets it up with the determined internal clock as clock input.
 	TC_Configure(t.tc, t.channel, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | clock);
+	_pulsePin[timer] = -1;
+	_tickDivisor[timer] = 0;
 	// Reset counter and fire interrupt when RC value is matched:
 	TC_SetRC(t.tc, t.channel, rc);
 	// Enable the RC Compare Interrupt...
@@ -229,6 +233,234 @@ DueTimer& DueTimer::setFrequency(double frequency){
 	return *this;
 }
 
+DueTimer& DueTimer::setPriority(uint32_t priority){
+	/*
+		Set the NVIC priority of the timer interrupt, from 0 (goes first,
+		and can interrupt the others) to 15 (goes last). Timers start at 0
+	*/
+
+	NVIC_SetPriority(Timers[timer].irq, priority);
+
+	return *this;
+}
+
+DueTimer& DueTimer::setTickClock(uint32_t divisor){
+	/*
+		Set the timer up once to count at MCK / divisor (2, 8, 32 or 128),
+		so that startTicks can re-arm it without working out a clock.
+		Any other divisor is not a clock the timer has, so the timer
+		is left as it was
+	*/
+
+	// Get current timer configuration
+	Timer t = Timers[timer];
+
+	uint32_t clock;
+
+	switch (divisor) {
+	  case 2:
+	    clock = TC_CMR_TCCLKS_TIMER_CLOCK1;
+	    break;
+	  case 8:
+	    clock = TC_CMR_TCCLKS_TIMER_CLOCK2;
+	    break;
+	  case 32:
+	    clock = TC_CMR_TCCLKS_TIMER_CLOCK3;
+	    break;
+	  case 128:
+	    clock = TC_CMR_TCCLKS_TIMER_CLOCK4;
+	    break;
+	  default:
+	    return *this;
+	}
+
+	pmc_set_writeprotect(false);
+	pmc_enable_periph_clk((uint32_t)t.irq);
+
+	// Same waveform mode as setFrequency, with the clock fixed
+	TC_Configure(t.tc, t.channel, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | clock);
+	_pulsePin[timer] = -1;
+	// Until startTicks this is the rate the timer counts at,
+	// which also keeps start() from setting a frequency over it
+	_frequency[timer] = (double)VARIANT_MCK / divisor;
+	_tickDivisor[timer] = divisor;
+	// Enable the RC Compare Interrupt...
+	t.tc->TC_CHANNEL[t.channel].TC_IER=TC_IER_CPCS;
+	// ... and disable all others.
+	t.tc->TC_CHANNEL[t.channel].TC_IDR=~TC_IER_CPCS;
+
+	return *this;
+}
+
+DueTimer& DueTimer::startTicks(uint32_t ticks){
+	/*
+		Start the timer to fire every ticks counts of the clock
+		picked by setTickClock. It is only a few register writes,
+		with no float math, so it is cheap enough to use in interrupts.
+		getFrequency works the frequency out from the ticks when asked
+	*/
+
+	const Timer &t = Timers[timer];
+	TcChannel *channel = &t.tc->TC_CHANNEL[t.channel];
+
+	channel->TC_RC = ticks;
+
+	NVIC_ClearPendingIRQ(t.irq);
+	NVIC_EnableIRQ(t.irq);
+
+	channel->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+
+	return *this;
+}
+
+DueTimer& DueTimer::startCapture(uint32_t pin, uint32_t mode){
+	/*
+		Start the timer counting freely at CAPTURE_FREQUENCY, and latch
+		the count on every edge (RISING, FALLING or CHANGE) of the pin.
+		The pin has to be this timer's TIOA line. The callback is called
+		on every edge, and can read the latched count with getCapture(),
+		so it does not matter how long the interrupt took to get there
+	*/
+
+	// Get current timer configuration
+	Timer t = Timers[timer];
+
+	uint32_t edge;
+	uint32_t loads = TC_IER_LDRAS;
+
+	// RA only loads again once RB has loaded since, so RB has to load
+	// on the other edge even when nothing reads it, or RA would only
+	// ever latch the first edge
+	switch (mode) {
+	  case FALLING:
+	    edge = TC_CMR_LDRA_FALLING | TC_CMR_LDRB_RISING;
+	    break;
+	  case CHANGE:
+	    // RA and RB take turns, and both interrupt
+	    edge = TC_CMR_LDRA_RISING | TC_CMR_LDRB_FALLING;
+	    loads |= TC_IER_LDRBS;
+	    break;
+	  default: // RISING
+	    edge = TC_CMR_LDRA_RISING | TC_CMR_LDRB_FALLING;
+	    break;
+	}
+
+	pmc_set_writeprotect(false);
+	pmc_enable_periph_clk((uint32_t)t.irq);
+
+	// Hand the pin over from the PIO controller to the timer
+	PIO_Configure(
+		g_APinDescription[pin].pPort,
+		g_APinDescription[pin].ulPinType,
+		g_APinDescription[pin].ulPin,
+		g_APinDescription[pin].ulPinConfiguration);
+
+	// Set up the Timer in capture mode, counting up through the whole
+	// 32 bits and wrapping, and loading RA and RB on the edges of TIOA
+	TC_Configure(t.tc, t.channel, TC_CMR_TCCLKS_TIMER_CLOCK3 | edge);
+	_pulsePin[timer] = -1;
+	_tickDivisor[timer] = 0;
+	_frequency[timer] = (double)CAPTURE_FREQUENCY;
+
+	// Enable the Load Interrupts for the edges asked for...
+	t.tc->TC_CHANNEL[t.channel].TC_IER=loads;
+	// ... and disable all others.
+	t.tc->TC_CHANNEL[t.channel].TC_IDR=~loads;
+
+	NVIC_ClearPendingIRQ(t.irq);
+	NVIC_EnableIRQ(t.irq);
+
+	TC_Start(t.tc, t.channel);
+
+	return *this;
+}
+
+DueTimer& DueTimer::startPulse(uint32_t pin, uint32_t delay, uint32_t width){
+	/*
+		Drive the pin high delay counts from now, and low again width
+		counts after that, counting at CAPTURE_FREQUENCY.
+		The timer drives the pin itself, so both edges land on the count
+		no matter what interrupts are running. The pin has to be this
+		timer's TIOA or TIOB line. The callback is called once the pin
+		has gone low, and the timer then stops until the next pulse.
+		The timer is only set up on the first pulse on a pin, after that
+		a pulse is just a few register writes
+	*/
+
+	const Timer &t = Timers[timer];
+	TcChannel *channel = &t.tc->TC_CHANNEL[t.channel];
+	bool lineB = g_APinDescription[pin].ulTCChannel & 1;
+
+	uint32_t mode;
+
+	// The compares only match on counts after the start
+	if(delay < 1) { delay = 1; }
+	if(width < 1) { width = 1; }
+
+	if(_pulsePin[timer] != (int)pin){
+		pmc_set_writeprotect(false);
+		pmc_enable_periph_clk((uint32_t)t.irq);
+
+		// Hand the pin over from the PIO controller to the timer
+		PIO_Configure(
+			g_APinDescription[pin].pPort,
+			g_APinDescription[pin].ulPinType,
+			g_APinDescription[pin].ulPin,
+			g_APinDescription[pin].ulPinConfiguration);
+
+		// Set up the Timer in waveform mode, counting up from 0
+		// and stopping at RC. The start clears the pin, the first
+		// compare sets it and RC clears it again
+		mode = TC_CMR_WAVE | TC_CMR_WAVSEL_UP | TC_CMR_CPCSTOP | TC_CMR_TCCLKS_TIMER_CLOCK3;
+		if(lineB){
+			// TIOB is only an output if it is not the external event input
+			mode |= TC_CMR_EEVT_XC0 | TC_CMR_BSWTRG_CLEAR | TC_CMR_BCPB_SET | TC_CMR_BCPC_CLEAR;
+		}
+		else{
+			mode |= TC_CMR_ASWTRG_CLEAR | TC_CMR_ACPA_SET | TC_CMR_ACPC_CLEAR;
+		}
+		TC_Configure(t.tc, t.channel, mode);
+		_tickDivisor[timer] = 0;
+		_frequency[timer] = (double)CAPTURE_FREQUENCY;
+
+		// Enable the RC Compare Interrupt...
+		channel->TC_IER=TC_IER_CPCS;
+		// ... and disable all others.
+		channel->TC_IDR=~TC_IER_CPCS;
+
+		_pulsePin[timer] = pin;
+	}
+
+	if(lineB)
+		channel->TC_RB = delay;
+	else
+		channel->TC_RA = delay;
+	channel->TC_RC = delay + width;
+
+	NVIC_ClearPendingIRQ(t.irq);
+	NVIC_EnableIRQ(t.irq);
+
+	channel->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+
+	return *this;
+}
+
+uint32_t DueTimer::getCapture(void) const {
+	/*
+		Get the count latched on the last captured edge
+	*/
+
+	return captureOf(&Timers[timer].tc->TC_CHANNEL[Timers[timer].channel]);
+}
+
+uint32_t DueTimer::getCounter(void) const {
+	/*
+		Get the current count
+	*/
+
+	return Timers[timer].tc->TC_CHANNEL[Timers[timer].channel].TC_CV;
+}
+
 DueTimer& DueTimer::setPeriod(unsigned long microseconds){
 	/*
 		Set the period of the timer (in microseconds)
@@ -245,9 +477,22 @@ double DueTimer::getFrequency(void) const {
 		Get current time frequency
 	*/
 
+	// After startTicks it is the clock over the ticks it was started with
+	uint32_t rc = Timers[timer].tc->TC_CHANNEL[Timers[timer].channel].TC_RC;
+	if(_tickDivisor[timer] && rc)
+		return (double)VARIANT_MCK / _tickDivisor[timer] / rc;
+
 	return _frequency[timer];
 }
 
+uint32_t DueTimer::getPriority(void) const {
+	/*
+		Get the NVIC priority of the timer interrupt
+	*/
+
+	return NVIC_GetPriority(Timers[timer].irq);
+}
+
 long DueTimer::getPeriod(void) const {
 	/*
 		Get current time period
@@ -260,46 +505,64 @@ long DueTimer::getPeriod(void) const {
 /*
 	Implementation of the timer callbacks defined in 
 	arduino-1.5.2/hardware/arduino/sam/system/CMSIS/Device/ATMEL/sam3xa/include/sam3x8e.h
+	A timer listed with DUETIMER_BIND_TCn in DueTimer.h gets its handler
+	from the sketch instead, so that one is left out here
 */
 // Fix for compatibility with Servo library
-#ifndef USING_SERVO_LIB
+#if !defined(USING_SERVO_LIB) && !defined(DUETIMER_BIND_TC0)
 void TC0_Handler(void){
 	TC_GetStatus(TC0, 0);
 	DueTimer::callbacks[0]();
 }
 #endif
+#ifndef DUETIMER_BIND_TC1
 void TC1_Handler(void){
 	TC_GetStatus(TC0, 1);
 	DueTimer::callbacks[1]();
 }
+#endif
 // Fix for compatibility with Servo library
 #ifndef USING_SERVO_LIB
+#ifndef DUETIMER_BIND_TC2
 void TC2_Handler(void){
 	TC_GetStatus(TC0, 2);
 	DueTimer::callbacks[2]();
 }
+#endif
+#ifndef DUETIMER_BIND_TC3
 void TC3_Handler(void){
 	TC_GetStatus(TC1, 0);
 	DueTimer::callbacks[3]();
 }
+#endif
+#ifndef DUETIMER_BIND_TC4
 void TC4_Handler(void){
 	TC_GetStatus(TC1, 1);
 	DueTimer::callbacks[4]();
 }
+#endif
+#ifndef DUETIMER_BIND_TC5
 void TC5_Handler(void){
 	TC_GetStatus(TC1, 2);
 	DueTimer::callbacks[5]();
 }
 #endif
+#endif
+#ifndef DUETIMER_BIND_TC6
 void TC6_Handler(void){
 	TC_GetStatus(TC2, 0);
 	DueTimer::callbacks[6]();
 }
+#endif
+#ifndef DUETIMER_BIND_TC7
 void TC7_Handler(void){
 	TC_GetStatus(TC2, 1);
 	DueTimer::callbacks[7]();
 }
+#endif
+#ifndef DUETIMER_BIND_TC8
 void TC8_Handler(void){
 	TC_GetStatus(TC2, 2);
 	DueTimer::callbacks[8]();
 }
+#endif
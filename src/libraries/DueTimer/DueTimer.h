@@ -30,9 +30,39 @@
 	#warning "HEY! You have set flag USING_SERVO_LIB. Timer0, 2,3,4 and 5 are not available"
 #endif
 
+/*
+	Timers that a sketch binds its own handler to with DUETIMER_HANDLER
+	or DUETIMER_STATUS_HANDLER have to be listed here, so that DueTimer.cpp
+	leaves its handler for them out. DUETIMER_HANDLER does not compile
+	for a timer that is not listed. Only list timers the sketch binds:
+	one that is listed and not bound gets the Arduino core's default
+	handler, which hangs if the timer ever interrupts.
+
+	These are the timers the ECU binds.
+*/
+#define DUETIMER_BIND_TC0	true
+#define DUETIMER_BIND_TC6	true
+#define DUETIMER_BIND_TC7	true
+
 
 #define NUM_TIMERS  9
 
+// Rate (in Hz) that a timer counts at in capture and pulse mode (TIMER_CLOCK3, MCK / 32)
+#define CAPTURE_FREQUENCY (VARIANT_MCK / 32)
+
+// Gets the count latched on the last captured edge of a channel.
+// On CHANGE, RA has the rising edges and RB the falling ones,
+// so the last edge is whichever was latched closer behind the count
+static inline uint32_t captureOf(TcChannel *channel){
+	if(channel->TC_IMR & TC_IMR_LDRBS){
+		uint32_t now = channel->TC_CV;
+		uint32_t a = channel->TC_RA;
+		uint32_t b = channel->TC_RB;
+		return now - b < now - a ? b : a;
+	}
+	return channel->TC_RA;
+}
+
 class DueTimer
 {
 protected:
@@ -44,6 +74,15 @@ protected:
 	// (allows to access current timer period and frequency):
 	static double _frequency[NUM_TIMERS];
 
+	// Stores the pin each timer last drove pulses on, so it is only set up once
+	// (-1 once the timer has been set up for anything else)
+	static int _pulsePin[NUM_TIMERS];
+
+	// Stores the divisor setTickClock set each timer's clock to, so its
+	// frequency can be worked out from the ticks it was started with
+	// (0 once the timer has been set up for anything else)
+	static uint8_t _tickDivisor[NUM_TIMERS];
+
 	// Picks the best clock to lower the error
 	static uint8_t bestClock(double frequency, uint32_t& retRC);
 
@@ -81,11 +120,73 @@ public:
 	DueTimer& stop(void);
 	DueTimer& setFrequency(double frequency);
 	DueTimer& setPeriod(unsigned long microseconds);
+	DueTimer& setTickClock(uint32_t divisor = 32);
+	DueTimer& setPriority(uint32_t priority);
+	DueTimer& startTicks(uint32_t ticks);
+	DueTimer& startCapture(uint32_t pin, uint32_t mode = RISING);
+	DueTimer& startPulse(uint32_t pin, uint32_t delay, uint32_t width);
+
+	uint32_t getCapture(void) const;
+	uint32_t getCounter(void) const;
 
 	double getFrequency(void) const;
 	long getPeriod(void) const;
+	uint32_t getPriority(void) const;
+};
+
+/*
+	Binds a handler to timer N at compile time, instead of through
+	attachInterrupt. The handler is called straight from the interrupt,
+	so the compiler can inline it, and there is no callback to look up.
+	Use it at file scope, after the handler:
+		DUETIMER_HANDLER(7, sparkISR)
+	The timer has to be listed with DUETIMER_BIND_TC7 at the top of this file.
+	attachInterrupt does nothing for a timer bound this way.
+	DueTimerChannel<N> on its own also reads the timer's counts inline,
+	for when getCounter() is too slow.
+*/
+template <int N, void (*isr)() = nullptr>
+struct DueTimerChannel
+{
+	static_assert(N >= 0 && N < NUM_TIMERS, "There are only timers 0 to 8");
+
+	static inline TcChannel *channel(void){
+		return &(N < 3 ? TC0 : N < 6 ? TC1 : TC2)->TC_CHANNEL[N % 3];
+	}
+
+	// Same as getCounter()
+	static inline uint32_t counter(void){
+		return channel()->TC_CV;
+	}
+
+	// Same as getCapture()
+	static inline uint32_t capture(void){
+		return captureOf(channel());
+	}
+
+	static inline void handler(void){
+		// Reading the status clears the interrupt
+		(void)channel()->TC_SR;
+		isr();
+	}
 };
 
+#define DUETIMER_HANDLER(n, isr) DUETIMER_HANDLER_PASTE(n, isr)
+#define DUETIMER_HANDLER_PASTE(n, isr) \
+	static_assert(DUETIMER_BIND_TC##n, "list this timer with DUETIMER_BIND_TC" #n " in DueTimer.h"); \
+	void TC##n##_Handler(void){ DueTimerChannel<n, isr>::handler(); }
+
+/*
+	Same as DUETIMER_HANDLER, for a handler that takes the timer's
+	status, void isr(uint32_t status). Reading the status clears it,
+	so this is how a handler tells which of the timer's interrupts
+	it was called for, like a capture (TC_SR_LDRAS) or a wrap (TC_SR_COVFS).
+*/
+#define DUETIMER_STATUS_HANDLER(n, isr) DUETIMER_STATUS_HANDLER_PASTE(n, isr)
+#define DUETIMER_STATUS_HANDLER_PASTE(n, isr) \
+	static_assert(DUETIMER_BIND_TC##n, "list this timer with DUETIMER_BIND_TC" #n " in DueTimer.h"); \
+	void TC##n##_Handler(void){ isr(DueTimerChannel<n>::channel()->TC_SR); }
+
 // Just to call Timer.getAvailable instead of Timer::getAvailable() :
 extern DueTimer Timer;
 
@@ -0,0 +1,44 @@
+#include <DueTimer.h>
+
+/*
+	Counts the CPU cycles it takes to arm a timer with start(microseconds),
+	which works out the clock and period with float math every time,
+	and with startTicks(ticks), which just writes the period
+*/
+
+void handler(){
+}
+
+uint32_t slowCycles, fastCycles;
+
+void setup(){
+	uint32_t before;
+
+	Serial.begin(9600);
+
+	// Turn on the CPU cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	Timer3.attachInterrupt(handler);
+	before = DWT->CYCCNT;
+	Timer3.start(1000);
+	slowCycles = DWT->CYCCNT - before;
+	Timer3.stop();
+
+	Timer4.attachInterrupt(handler).setTickClock(32);
+	before = DWT->CYCCNT;
+	Timer4.startTicks(2625); // 1000 microseconds at MCK / 32
+	fastCycles = DWT->CYCCNT - before;
+	Timer4.stop();
+}
+
+void loop(){
+	Serial.print("start(1000): ");
+	Serial.print(slowCycles);
+	Serial.print(" cycles    startTicks(2625): ");
+	Serial.print(fastCycles);
+	Serial.println(" cycles");
+	delay(2000);
+}
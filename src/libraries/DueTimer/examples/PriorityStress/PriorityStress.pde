@@ -0,0 +1,116 @@
+#include <DueTimer.h>
+
+/*
+	Measures how late a capture interrupt runs after its edge while
+	another timer interrupt keeps the CPU busy and Serial is printing,
+	first with every interrupt at the same priority and then with the
+	capture timer first, the way the ECU sets them up.
+	It also times how long loop() is held up printing a block of
+	telemetry all at once, against one line only when it fits.
+
+	Wire pin 5 (TIOA6) to pin 2 (TIOA0). Timer6 pulses pin 5,
+	and Timer0 latches the count on each rising edge of pin 2
+*/
+
+#define EDGE_TICKS 525        // 200 microseconds between edges, at CAPTURE_FREQUENCY
+#define BUSY_MICROS 20        // how long the busy interrupt spins for
+#define RUN_MILLIS 2000       // how long each priority setup runs for
+#define TELEMETRY_BYTES 380   // about what the ECU used to print at once
+#define LINE_BYTES 72
+
+volatile uint32_t worstLatency;   // in ticks of CAPTURE_FREQUENCY
+volatile uint32_t edges;
+
+void captured(){
+	uint32_t latency = Timer0.getCounter() - Timer0.getCapture();
+
+	if(latency > worstLatency)
+		worstLatency = latency;
+	edges++;
+}
+
+void pulsed(){
+	Timer6.startPulse(5, EDGE_TICKS - 50, 50);
+}
+
+void busy(){
+	uint32_t start = micros();
+
+	while(micros() - start < BUSY_MICROS)
+		;
+}
+
+/*
+	Runs the edges and the busy interrupt for RUN_MILLIS,
+	printing all the while, and gives the worst latency in microseconds
+*/
+float stress(uint32_t capturePriority, uint32_t otherPriority){
+	uint32_t start;
+
+	Timer0.setPriority(capturePriority);
+	Timer6.setPriority(otherPriority);
+	Timer3.setPriority(otherPriority);
+	NVIC_SetPriority(UART_IRQn, otherPriority);
+
+	worstLatency = 0;
+	edges = 0;
+	Timer0.startCapture(2, RISING);
+	Timer6.startPulse(5, EDGE_TICKS, 50);
+	Timer3.start(97);	// not a multiple of the edges, so it lands all over them
+
+	start = millis();
+	while(millis() - start < RUN_MILLIS)
+		Serial.println("keeping the UART interrupt busy");
+
+	Timer3.stop();
+	Timer6.stop();
+	Timer0.stop();
+	Serial.flush();
+
+	return worstLatency * 1e6f / CAPTURE_FREQUENCY;
+}
+
+/*
+	Gives how long printing bytes holds loop() up for, in microseconds,
+	with the Serial buffer empty to start with
+*/
+uint32_t printTime(int bytes){
+	uint32_t start;
+	int i;
+
+	Serial.flush();
+	start = micros();
+	for(i = 0; i < bytes; i++)
+		Serial.write('.');
+	return micros() - start;
+}
+
+float sameLatency, plannedLatency;
+uint32_t allTime, lineTime;
+
+void setup(){
+	Serial.begin(115200);
+
+	Timer0.attachInterrupt(captured);
+	Timer6.attachInterrupt(pulsed);
+	Timer3.attachInterrupt(busy);
+
+	sameLatency = stress(0, 0);
+	plannedLatency = stress(0, 8);
+
+	allTime = printTime(TELEMETRY_BYTES);
+	lineTime = printTime(LINE_BYTES);
+	Serial.println();
+}
+
+void loop(){
+	Serial.print("worst capture latency(us)  same priority: ");
+	Serial.print(sameLatency);
+	Serial.print("    capture first: ");
+	Serial.println(plannedLatency);
+	Serial.print("loop held up printing(us)  all at once: ");
+	Serial.print(allTime);
+	Serial.print("    one line: ");
+	Serial.println(lineTime);
+	delay(2000);
+}
@@ -0,0 +1,99 @@
+//bench.h
+//A few helpers for the host benchmarks. Each benchmark is its own program
+//that prints what it measured. The times are from whatever machine runs
+//them, which has an FPU and a cache the Due does not, so they only show
+//how one way compares with another in the same run, not Due timings.
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define benchCycles() __rdtsc()
+#else
+#define benchCycles() 0ULL
+#endif
+
+/*  Results go here so the compiler cannot throw the work away. */
+static volatile float benchSink;
+
+static unsigned int benchSeed = 1;
+
+/* This is a helper function used to give a repeatable random number from 0 to 1. */
+static inline float benchRandom() {
+   benchSeed = benchSeed * 1103515245 + 12345;
+   return (benchSeed >> 8) * (1.0f / 16777216);
+}
+
+/* This is a helper function used to get the time in seconds. */
+static inline double benchSeconds() {
+   return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*    This is a function used to make a trace like a running engine,
+   wandering a little way each cycle and mostly staying in the same cell.
+   Points stay inside x0 to x1 and y0 to y1. */
+static inline void benchSteady(float *xs, float *ys, int count, float x0, float x1, float y0, float y1) {
+   float x = (x0 + x1) / 2, y = (y0 + y1) / 2;
+   int i;
+
+   for (i = 0; i < count; i++) {
+      x += (benchRandom() - 0.5f) * (x1 - x0) * 0.004f;
+      y += (benchRandom() - 0.5f) * (y1 - y0) * 0.004f;
+      x = x < x0 ? x0 : x > x1 ? x1 : x;
+      y = y < y0 ? y0 : y > y1 ? y1 : y;
+      xs[i] = x;
+      ys[i] = y;
+   }
+}
+
+/*    This is a function used to make a trace that sweeps back and forth
+   across the whole of x while y goes more slowly across the whole of y,
+   so every few points cross into another cell. */
+static inline void benchSweep(float *xs, float *ys, int count, float x0, float x1, float y0, float y1) {
+   float t;
+   int i;
+
+   for (i = 0; i < count; i++) {
+      t = fmodf(i * (64.0f / count), 2);
+      xs[i] = x0 + (x1 - x0) * (t < 1 ? t : 2 - t);
+      t = fmodf(i * (6.0f / count), 2);
+      ys[i] = y0 + (y1 - y0) * (t < 1 ? t : 2 - t);
+   }
+}
+
+/*    This is a function used to make a trace of points anywhere at all,
+   with no two in a row anywhere near each other. */
+static inline void benchJumps(float *xs, float *ys, int count, float x0, float x1, float y0, float y1) {
+   int i;
+
+   for (i = 0; i < count; i++) {
+      xs[i] = x0 + (x1 - x0) * benchRandom();
+      ys[i] = y0 + (y1 - y0) * benchRandom();
+   }
+}
+
+/* This is a helper function used to print the time per point of a run. */
+static inline void benchReport(const char *what, double seconds, unsigned long long cycles, long count) {
+   printf("  %-34s %7.2f ns  %7.1f cycles  %7.1f M/s\n", what, seconds * 1e9 / count, (double)cycles / count,
+          count / seconds * 1e-6);
+}
+
+/*    This runs body once for each i from 0 to count and reports the time per run. */
+#define BENCH(what, count, body) do { \
+   long benchI_, benchN_ = (count); \
+   double benchStart_ = benchSeconds(); \
+   unsigned long long benchCycles_ = benchCycles(); \
+   for (benchI_ = 0; benchI_ < benchN_; benchI_++) { \
+      long i = benchI_; \
+      body; \
+   } \
+   benchCycles_ = benchCycles() - benchCycles_; \
+   benchReport(what, benchSeconds() - benchStart_, benchCycles_, benchN_); \
+} while (0)
+
+#endif
@@ -0,0 +1,121 @@
+//capture_jitter.cpp
+//How far tooth periods are off when tach edges are timestamped by
+//micros() at the top of the interrupt, as the ECU did before input
+//capture, and when they come from the capture registers.
+//The edges are run through the mock Timer Counter in stub/, so the
+//capture columns use the same register setup as the firmware.
+//The interrupt latency is a model, not a measurement: each edge takes
+//ENTRY_US to reach the handler, and BLOCK_CHANCE of them also wait
+//up to BLOCK_MAX_US behind another interrupt or a critical section.
+//These numbers are from the host, not from a Due.
+#include <stdio.h>
+#include <math.h>
+#include <Arduino.h>
+#include "DueTimer.h"
+
+#define TEETH_PER_REV 12
+#define REVS 2000
+#define ENTRY_US 0.3
+#define BLOCK_CHANCE 0.3
+#define BLOCK_MAX_US 8.0
+#define TICK_US (1e6 / CAPTURE_FREQUENCY)
+
+typedef struct jitter_t {
+   double sumSquares;
+   double worst;
+   long count;
+   long stale;    // edges that did not latch a new count
+} jitter_t;
+
+static unsigned int seed = 12345;
+
+/* This is a helper function used to give a repeatable random number from 0 to 1. */
+static double randomUnit() {
+   seed = seed * 1103515245 + 12345;
+   return (seed >> 8) / 16777216.0;
+}
+
+/* This is a helper function used to add one period error to the totals. */
+static void addError(jitter_t *jitter, double error) {
+   jitter->sumSquares += error * error;
+   if (fabs(error) > jitter->worst)
+      jitter->worst = fabs(error);
+   jitter->count++;
+}
+
+/* This is a helper function used to print one row. */
+static void printJitter(const char *what, int rpm, jitter_t *jitter) {
+   double rms = sqrt(jitter->sumSquares / jitter->count);
+   double degreesPerUs = rpm * 360.0 / 60e6;
+
+   printf("  %-26s %5d rpm  rms %6.3f us  worst %6.3f us  (%.3f deg)  stale %ld\n", what, rpm, rms, jitter->worst,
+          jitter->worst * degreesPerUs, jitter->stale);
+}
+
+/*    This is a function used to run a steady tooth wheel through Timer0
+   and time each tooth period both ways. loads is the capture setup,
+   so the RA only setup from before the fix can be run the same way. */
+static void runWheel(int rpm, uint32_t loads, jitter_t *old, jitter_t *captured) {
+   TcChannel *channel = DueTimerChannel<0>::channel();
+   double toothUs = 60e6 / rpm / TEETH_PER_REV;
+   double edgeUs, handlerUs, ticksUs = 0;
+   double lastMicros = -1, lastCapture = -1, nowMicros, nowCapture;
+   uint32_t lastRaw = 0, raw;
+   long tooth;
+
+   tcMockReset();
+   Timer0.startCapture(2, RISING);
+   channel->TC_CMR = (channel->TC_CMR & ~(TC_CMR_LDRA_Msk | TC_CMR_LDRB_Msk)) | loads;
+
+   for (tooth = 1; tooth <= REVS * TEETH_PER_REV; tooth++) {
+      edgeUs = tooth * toothUs;
+      handlerUs = edgeUs + ENTRY_US;
+      if (randomUnit() < BLOCK_CHANCE)
+         handlerUs += randomUnit() * BLOCK_MAX_US;
+
+      // rising edge at edgeUs, falling half a tooth later
+      tcMockCount(channel, (uint32_t)(edgeUs / TICK_US) - (uint32_t)(ticksUs / TICK_US));
+      ticksUs = edgeUs;
+      tcMockEdge(channel, 1);
+      tcMockCount(channel, (uint32_t)(handlerUs / TICK_US) - (uint32_t)(ticksUs / TICK_US));
+      ticksUs = handlerUs;
+
+      // what the handler sees
+      nowMicros = floor(handlerUs);
+      raw = Timer0.getCapture();
+      if (tooth > 1 && raw == lastRaw)
+         captured->stale++;
+      nowCapture = raw * TICK_US;
+      if (lastMicros >= 0) {
+         addError(old, nowMicros - lastMicros - toothUs);
+         addError(captured, nowCapture - lastCapture - toothUs);
+      }
+      lastMicros = nowMicros;
+      lastCapture = nowCapture;
+      lastRaw = raw;
+
+      tcMockCount(channel, (uint32_t)((edgeUs + toothUs / 2) / TICK_US) - (uint32_t)(ticksUs / TICK_US));
+      ticksUs = edgeUs + toothUs / 2;
+      tcMockEdge(channel, 0);
+   }
+}
+
+int main() {
+   int rpms[] = {1000, 4000, 8000};
+   unsigned int i;
+
+   printf("tooth period error, %d teeth, %d revs, latency model %.1f us + %.0f%% blocked up to %.1f us\n",
+          TEETH_PER_REV, REVS, ENTRY_US, BLOCK_CHANCE * 100, BLOCK_MAX_US);
+   for (i = 0; i < sizeof(rpms) / sizeof(rpms[0]); i++) {
+      jitter_t old = {}, loadA = {}, loadAB = {}, unused = {};
+
+      seed = 12345;
+      runWheel(rpms[i], TC_CMR_LDRA_RISING, &old, &loadA);
+      seed = 12345;
+      runWheel(rpms[i], TC_CMR_LDRA_RISING | TC_CMR_LDRB_FALLING, &unused, &loadAB);
+      printJitter("micros() in the handler", rpms[i], &old);
+      printJitter("capture, RA only", rpms[i], &loadA);
+      printJitter("capture, RA and RB", rpms[i], &loadAB);
+   }
+   return 0;
+}
@@ -0,0 +1,97 @@
+//dense_grid.cpp
+//For dense grids of a few sizes over VE and SA, gives the RAM each takes,
+//how long it takes to build, how far it strays from the table, and how
+//fast it looks up against tableLookup on a random walk. Then it tunes a
+//few SA cells and times refreshing just those against a full rebuild.
+#include <string.h>
+#include "table.h"
+#include "tuning.h"
+#include "bench.h"
+
+#define POINTS 5000000
+#define BUILDS 200
+#define SWEEP_STEPS 2000
+
+float xs[POINTS], ys[POINTS];
+float gridData[64 * 64], builtData[64 * 64];
+int sizes[] = {16, 32, 64};
+
+/*    This is a function used to give the largest difference between
+   a grid and its table, over a fine sweep of the whole table. */
+static float gridError(densegrid_t *grid) {
+   table_t *table = grid->src;
+   float x, y, difference, worst = 0;
+   int i, j;
+
+   for (j = 0; j <= SWEEP_STEPS; j++) {
+      y = table->yVals[0] + (table->yVals[table->height - 1] - table->yVals[0]) * j / SWEEP_STEPS;
+      for (i = 0; i <= SWEEP_STEPS; i++) {
+         x = table->xVals[0] + (table->xVals[table->width - 1] - table->xVals[0]) * i / SWEEP_STEPS;
+         difference = fabsf(denseLookup(grid, x, y) - tableLookup(table, x, y));
+         if (difference > worst)
+            worst = difference;
+      }
+   }
+   return worst;
+}
+
+/*    This is a function used to run every grid size over a table. */
+static void run(const char *name, table_t *table) {
+   densegrid_t grid;
+   char what[64];
+   double start, build;
+   int i, n, size;
+
+   printf("%s\n", name);
+   benchSteady(xs, ys, POINTS, table->xVals[0], table->xVals[table->width - 1],
+               table->yVals[0], table->yVals[table->height - 1]);
+   for (n = 0; n < (int)(sizeof(sizes) / sizeof(sizes[0])); n++) {
+      size = sizes[n];
+      denseInit(&grid, table, size, size, gridData);
+      start = benchSeconds();
+      for (i = 0; i < BUILDS; i++)
+         denseBuild(&grid);
+      build = (benchSeconds() - start) / BUILDS;
+      printf("  %dx%d: %d bytes, build %.1f us, largest error %.3g\n", size, size,
+             (int)(size * size * sizeof(float)), build * 1e6, gridError(&grid));
+      snprintf(what, sizeof(what), "%dx%d denseLookup", size, size);
+      BENCH(what, POINTS, benchSink = denseLookup(&grid, xs[i], ys[i]));
+   }
+   BENCH("tableLookup", POINTS, benchSink = tableLookup(table, xs[i], ys[i]));
+}
+
+overlay_t tunedOverlay;
+Table<12, 12, int16_t> tunedSA(xAxisSA, yAxisSA, xRecipSA, yRecipSA, dataSA, defaultSA, scaleSA, 0, &tunedOverlay);
+
+/*    This is a function used to tune three SA cells and time refreshing
+   a 64x64 grid for them, then check it against building it over. */
+static void refresh() {
+   densegrid_t grid, built;
+   int cells[3][2] = {{2, 3}, {7, 7}, {11, 10}};
+   unsigned long long cycles;
+   double start;
+   int i, n;
+
+   denseInit(&grid, &tunedSA, 64, 64, gridData);
+   for (i = 0; i < 3; i++)
+      setData(&tunedSA, cells[i][0], cells[i][1], getData(&tunedSA, cells[i][0], cells[i][1]) + 3);
+
+   // refreshing again gives the same grid, so it can be timed over many runs
+   start = benchSeconds();
+   cycles = benchCycles();
+   for (n = 0; n < BUILDS; n++)
+      for (i = 0; i < 3; i++)
+         denseRefresh(&grid, cells[i][0], cells[i][1]);
+   benchReport("refresh 3 tuned SA cells, 64x64", benchSeconds() - start, benchCycles() - cycles, BUILDS);
+
+   denseInit(&built, &tunedSA, 64, 64, builtData);
+   printf("  refreshed grid %s a full rebuild\n",
+          memcmp(gridData, builtData, sizeof(gridData)) ? "DIFFERS FROM" : "matches");
+}
+
+int main() {
+   run("VE", &VETable);
+   run("SA", &SATable);
+   refresh();
+   return 0;
+}
@@ -0,0 +1,214 @@
+//observer_timing.cpp
+//Runs a simulated 12-1 wheel from 1500 up to 8000 rpm and back down to
+//2000, with and without a once a cycle speed ripple, and times the spark
+//three ways: the old way, from the three revolution speed and the last
+//tooth period; with the observer, planned once at TDC; and with the
+//observer planned again after every tooth, the way loop() does it now.
+//It gives how far from the spark angle each spark really fired, in degrees,
+//and when the worst one was. It also checks the angle loop() works out
+//for each spark from the observer once the next tooth is in, which is
+//where realSparkAngle comes from, against where the crank really was.
+//
+//Planned once at TDC, the observer's worst spark is the first one after
+//the engine starts speeding up at 0.1 s. It was planned from teeth that
+//went by before the speed started changing over a whole cycle, which
+//is all the observer goes on, so nothing at TDC could have known about
+//it. The old way arms from the last tooth's speed, so it sees a little
+//of the change there, and its worst comes later, when the three
+//revolution speed falls behind. Planning again after every tooth is
+//what loop() does, and it takes that first spark from 26 degrees to 16.
+#include <vector>
+#include "scheduler.h"
+#include "observer.h"
+#include "timebase.h"
+#include "bench.h"
+
+#define NUM_TEETH 11
+#define CALIB_ANGLE 175      // the tooth after the missing one, at 145
+#define FIRE_DEGREES 340     // when the spark fires, in the cycle
+#define DWELL_MICROS 3500
+#define SECONDS 1.6
+#define STEP_MICROS 1.0
+#define WARMUP_DEGREES 1080  // so the old way has three revolutions to go on
+
+#define OLD 0
+#define ONCE 1
+#define EVERY 2
+
+const char *modes[] = {"old, 3 rev speed", "observer, once at TDC", "observer, every tooth"};
+
+std::vector<double> toothMicros;    // when each tooth went by
+std::vector<double> toothDegrees;   // where it was, counting up from the start without wrapping
+std::vector<double> crank;          // where the crank was at each STEP_MICROS
+angle_t toothAngles[NUM_TEETH];
+
+/* This is a helper function used to give the engine speed through the run. */
+static double rpmAt(double t) {
+   if (t < 0.1) return 1500;
+   if (t < 0.5) return 1500 + (t - 0.1) / 0.4 * 6500;
+   if (t < 0.8) return 8000;
+   if (t < 1.3) return 8000 - (t - 0.8) / 0.5 * 6000;
+   return 2000;
+}
+
+/*    This is a function used to turn the crank for the whole run, with
+   its speed going up and down by ripple once a cycle, and note each tooth. */
+static void turn(double ripple) {
+   double t = 0, angle = CALIB_ANGLE - 30 + 1e-4, next = CALIB_ANGLE, step;
+
+   toothMicros.clear();
+   toothDegrees.clear();
+   crank.clear();
+   while (t < SECONDS * 1e6) {
+      step = rpmAt(t * 1e-6) * 6e-6 * (1 + ripple * sin(angle * M_PI / 180)) * STEP_MICROS;
+      if (angle + step >= next) {
+         toothMicros.push_back(t + (next - angle) / step * STEP_MICROS);
+         toothDegrees.push_back(next);
+         next += 30;
+         if (fmod(next, 360) == CALIB_ANGLE - 30)
+            next += 30;
+      }
+      crank.push_back(angle);
+      angle += step;
+      t += STEP_MICROS;
+   }
+}
+
+/* This is a helper function used to give where the crank was at a time. */
+static double crankAt(double micros) {
+   size_t i = (size_t)(micros / STEP_MICROS);
+   double f = micros / STEP_MICROS - i;
+
+   return crank[i] + (crank[i + 1] - crank[i]) * f;
+}
+
+/* This is a helper function used to give a tooth's time on the timebase. */
+static stamp_t toothStamp(size_t i) {
+   return stamp_t(llround(toothMicros[i] * TICKS_PER_SECOND * 1e-6));
+}
+
+double toothTime;    // when the tooth the ISR is on went by
+double target;       // where this cycle's spark should fire, without wrapping
+double errorSquares, errorWorst, worstAt;
+double pendingFire;  // when the last spark fired, until a tooth after it has gone by
+int sparks;
+int sparkCycle;
+scheduler_t schedule;
+
+/*    This is the spark event. It notes how far from the target the spark
+   fired, DWELL_MICROS after it starts charging. */
+static void charge(ticks_t delay) {
+   double fire = toothTime + delay.raw * 1e6 / TICKS_PER_SECOND + DWELL_MICROS;
+   double error;
+
+   if (sparkCycle == schedule.cycle)
+      return;
+   sparkCycle = schedule.cycle;
+   if (fire >= (crank.size() - 1) * STEP_MICROS)
+      return;   // the run ends before this one fires
+   error = crankAt(fire) - target;
+   errorSquares += error * error;
+   if (fabs(error) > errorWorst) {
+      errorWorst = fabs(error);
+      worstAt = fire;
+   }
+   pendingFire = fire;
+   sparks++;
+}
+
+/*    This is a function used to time the spark through the whole run
+   one way, and print how it did. */
+static void run(int mode) {
+   crankobserver_t observer;
+   angle_t chargeAngle;
+   speed_t engineSpeed, toothSpeed;
+   size_t i, k;
+   int cycleTooth = -1, oldTooth = -1;
+   ticks_t oldDelay;
+   double measured, measuredSquares = 0, measuredWorst = 0;
+   int measures = 0;
+
+   schedulerInit(&schedule, toothAngles, NUM_TEETH, angleDegrees(30));
+   observerInit(&observer, NUM_TEETH, angleDegrees(360));
+   sparkCycle = -1;
+   sparks = 0;
+   errorSquares = errorWorst = worstAt = 0;
+   pendingFire = -1;
+
+   for (i = 0; i < toothMicros.size(); i++) {
+      // what tacISR does
+      toothTime = toothMicros[i];
+      if (fmod(toothDegrees[i], 360) == 25) {
+         cycleTooth = 0;
+         target = toothDegrees[i] - 25 + FIRE_DEGREES;
+         scheduleCycle(&schedule);
+      } else if (cycleTooth >= 0) {
+         cycleTooth++;
+      }
+      observerTooth(&observer, toothStamp(i), angleDegrees(fmod(toothDegrees[i], 360)));
+      if (cycleTooth < 0)
+         continue;
+      if (mode == OLD) {
+         if (cycleTooth == oldTooth)
+            charge(oldDelay);
+      } else {
+         scheduleTooth(&schedule, cycleTooth);
+      }
+
+      // what loop() does
+      observerRun(&observer);
+      if (pendingFire >= 0 && toothMicros[i] >= pendingFire && observerReady(&observer)) {
+         measured = angleToDegrees(observerAngleAt(&observer, stamp_t(llround(pendingFire * TICKS_PER_SECOND * 1e-6))));
+         measured = remainder(measured - crankAt(pendingFire), 360);
+         measuredSquares += measured * measured;
+         measuredWorst = fmax(measuredWorst, fabs(measured));
+         measures++;
+         pendingFire = -1;
+      }
+      if (toothDegrees[i] < WARMUP_DEGREES)
+         continue;
+      if (mode == OLD && cycleTooth == 0) {
+         for (k = i; toothDegrees[i] - toothDegrees[k] < 3 * 360; k--);
+         engineSpeed = speedFrom(angleDegrees(3 * 360), toothStamp(i) - toothStamp(k));
+         toothSpeed = speedFrom(angleDegrees(30), toothStamp(i) - toothStamp(i - 1));
+         chargeAngle = angleDegrees(FIRE_DEGREES) - ticksToAngle(ticksMicros(DWELL_MICROS), engineSpeed);
+         for (oldTooth = NUM_TEETH - 1; oldTooth > 0; oldTooth--) {
+            if (toothAngles[oldTooth] <= chargeAngle - angleDegrees(30))
+               break;
+         }
+         oldDelay = angleToTicks(chargeAngle - toothAngles[oldTooth], toothSpeed);
+      }
+      if (mode != OLD && observerReady(&observer) && (mode == EVERY || cycleTooth == 0)) {
+         scheduleClear(&schedule);
+         scheduleAdd(&schedule, observerAngleBefore(&observer, angleDegrees(FIRE_DEGREES), ticksMicros(DWELL_MICROS)),
+                     &observer, charge);
+         schedulePublish(&schedule);
+      }
+   }
+   printf("  %-24s rms %5.2f  worst %5.2f degrees over %d sparks, worst at %.3f s\n", modes[mode],
+          sqrt(errorSquares / sparks), errorWorst, sparks, worstAt * 1e-6);
+   if (mode == EVERY)
+      printf("  %-24s rms %5.2f  worst %5.2f degrees over %d sparks\n", "real spark angle", sqrt(measuredSquares / measures),
+             measuredWorst, measures);
+}
+
+int main() {
+   double ripples[] = {0, 0.08};
+   int i, first = 0;
+
+   // the same as setup() in ecu.ino
+   while (first < NUM_TEETH && CALIB_ANGLE + first * 30 < 360)
+      first++;
+   for (i = 0; i < NUM_TEETH; i++)
+      toothAngles[i] = angleDegrees((CALIB_ANGLE + ((first + i) % NUM_TEETH) * 30) % 360);
+
+   printf("spark angle error, 1500 to 8000 to 2000 rpm\n");
+   for (i = 0; i < 2; i++) {
+      printf("%g%% ripple\n", ripples[i] * 100);
+      turn(ripples[i]);
+      run(OLD);
+      run(ONCE);
+      run(EVERY);
+   }
+   return 0;
+}
@@ -0,0 +1,52 @@
+//table_batch.cpp
+//Replays a 10 million point random walk through the VE and SA tables with
+//tableLookupBatch and with one tableLookup per point, gives lookups per
+//second for each and checks the results are the same bit for bit.
+//Build with make clean bench ARCH=-mavx to time the AVX kernel instead of SSE2.
+#include <string.h>
+#include "table.h"
+#include "tablebatch.h"
+#include "tuning.h"
+#include "bench.h"
+
+#define POINTS 10000000
+
+float xs[POINTS], ys[POINTS], batch[POINTS], single[POINTS];
+
+/*    This is a function used to time both ways of looking a table up
+   along the trace, and count the points where they differ. */
+static void run(table_t *table) {
+   unsigned long long cycles;
+   double start;
+   int i, differ = 0;
+
+   benchSteady(xs, ys, POINTS, table->xVals[0], table->xVals[table->width - 1],
+               table->yVals[0], table->yVals[table->height - 1]);
+
+   BENCH("tableLookup", POINTS, single[i] = tableLookup(table, xs[i], ys[i]));
+   start = benchSeconds();
+   cycles = benchCycles();
+   tableLookupBatch(table, xs, ys, batch, POINTS);
+   benchReport("tableLookupBatch", benchSeconds() - start, benchCycles() - cycles, POINTS);
+
+   for (i = 0; i < POINTS; i++) {
+      if (memcmp(&batch[i], &single[i], sizeof(float)))
+         differ++;
+   }
+   printf("  %d of %d results differ\n", differ, POINTS);
+}
+
+int main() {
+#if defined(__AVX__)
+   printf("AVX kernel\n");
+#elif defined(__SSE2__)
+   printf("SSE2 kernel\n");
+#else
+   printf("plain C\n");
+#endif
+   printf("VE, per lookup\n");
+   run(&VETable);
+   printf("SA, per lookup\n");
+   run(&SATable);
+   return 0;
+}
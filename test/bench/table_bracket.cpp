@@ -0,0 +1,99 @@
+//table_bracket.cpp
+//Time per lookup of the VE and SA tables with the cached bracket,
+//against the linear scan from index 0 that tableLookup used to do,
+//on a steady engine, on a sweep across the whole map and on points
+//that jump anywhere. The old lookup is the same blend as tableLookup,
+//so only the axis search differs, and the searches are also timed on
+//their own, both axes per point.
+#include <string.h>
+#include "table.h"
+#include "tuning.h"
+#include "bench.h"
+
+#define POINTS 2000000
+
+/* This is the old findIndex, which walks the axis from the start every time. */
+static int oldFindIndex(const float *vals, float in) {
+   int i;
+   for (i = 0; in >= vals[i]; i++);
+   return i - 1;
+}
+
+/* This is axisPosition with the old findIndex. */
+static axispos_t oldPosition(const float *vals, const float *recip, int size, float in) {
+   axispos_t pos;
+   float lo, hi;
+
+   lo = vals[0];
+   hi = vals[size - 1];
+   in = in < hi ? in : hi;
+   in = in > lo ? in : lo;
+
+   pos.index = oldFindIndex(vals, in);
+   if (recip)
+      pos.weight = (in - vals[pos.index]) * recip[pos.index];
+   else
+      pos.weight = (in - vals[pos.index]) / (vals[pos.index + 1] - vals[pos.index]);
+   return pos;
+}
+
+/* This is tableLookup with the old findIndex. */
+static float oldLookup(table_t *table, float x, float y) {
+   if (x < table->xVals[0])
+      return table->defaultVal;
+   return tableBlend(table, table->width,
+      oldPosition(table->xVals, table->xRecip, table->width, x),
+      oldPosition(table->yVals, table->yRecip, table->height, y));
+}
+
+float xs[POINTS], ys[POINTS];
+
+/*    This is a function used to time one table on the trace in xs and ys,
+   both ways, and check they agree bit for bit. */
+static void run(const char *trace, table_t *table) {
+   char what[64];
+   float old, cached;
+   int i, differ = 0, xIndex = 0, yIndex = 0;
+
+   for (i = 0; i < POINTS; i++) {
+      old = oldLookup(table, xs[i], ys[i]);
+      cached = tableLookup(table, xs[i], ys[i]);
+      if (memcmp(&old, &cached, sizeof(float)))
+         differ++;
+      if (oldFindIndex(table->xVals, xs[i]) != tableFindIndex(table->xVals, table->width, xs[i], &xIndex) ||
+          oldFindIndex(table->yVals, ys[i]) != tableFindIndex(table->yVals, table->height, ys[i], &yIndex))
+         differ++;
+   }
+   snprintf(what, sizeof(what), "%s, linear search only", trace);
+   BENCH(what, POINTS, benchSink = oldFindIndex(table->xVals, xs[i]) + oldFindIndex(table->yVals, ys[i]));
+   snprintf(what, sizeof(what), "%s, cached search only", trace);
+   BENCH(what, POINTS, benchSink = tableFindIndex(table->xVals, table->width, xs[i], &xIndex) +
+                                   tableFindIndex(table->yVals, table->height, ys[i], &yIndex));
+   snprintf(what, sizeof(what), "%s, linear scan", trace);
+   BENCH(what, POINTS, benchSink = oldLookup(table, xs[i], ys[i]));
+   snprintf(what, sizeof(what), "%s, cached bracket", trace);
+   BENCH(what, POINTS, benchSink = tableLookup(table, xs[i], ys[i]));
+   if (differ)
+      printf("  %d lookups or searches differ\n", differ);
+}
+
+/*    This is a function used to run a table on every trace. The old scan
+   runs off the end of an axis, so the traces stay just inside them. */
+static void runTable(const char *name, table_t *table) {
+   float x0 = table->xVals[0], x1 = table->xVals[table->width - 1] - 1;
+   float y0 = table->yVals[0], y1 = table->yVals[table->height - 1] - 0.01f;
+
+   printf("%s, per lookup\n", name);
+   benchSteady(xs, ys, POINTS, x0, x1, y0, y1);
+   run("steady", table);
+   benchSweep(xs, ys, POINTS, x0, x1, y0, y1);
+   run("sweep", table);
+   benchJumps(xs, ys, POINTS, x0, x1, y0, y1);
+   run("jumps", table);
+}
+
+int main() {
+   runTable("VE", &VETable);
+   runTable("SA", &SATable);
+   return 0;
+}
@@ -0,0 +1,54 @@
+//table_coefs.cpp
+//Times VE, SA and PW looked up through cell coefficients against a
+//plain tableLookup of the same table on a random walk, and gives the
+//largest difference between the two.
+#include "table.h"
+#include "tuning.h"
+#include "bench.h"
+
+#define POINTS 5000000
+
+float xs[POINTS], ys[POINTS];
+tablecoef_t coefsVE[15 * 15], coefsSA[11 * 11], coefsPW[15 * 15];
+Table<16, 16, uint8_t> coefVE(xAxisVE, yAxisVE, xRecipVE, yRecipVE, dataVE, defaultVE, scaleVE);
+Table<12, 12, int16_t> coefSA(xAxisSA, yAxisSA, xRecipSA, yRecipSA, dataSA, defaultSA, scaleSA);
+Table<16, 16> coefPW(xAxisVE, yAxisVE, xRecipVE, yRecipVE, dataPW, defaultPW);
+
+/*    This is a function used to time a table and its copy that looks up
+   through coefficients, and check how far apart they come out. */
+static void run(const char *name, table_t *plain, table_t *coefs) {
+   float difference, worst = 0;
+   int i;
+
+   printf("%s, per lookup\n", name);
+   benchSteady(xs, ys, POINTS, plain->xVals[0], plain->xVals[plain->width - 1],
+               plain->yVals[0], plain->yVals[plain->height - 1]);
+   for (i = 0; i < POINTS; i++) {
+      difference = fabsf(tableLookup(plain, xs[i], ys[i]) - tableLookup(coefs, xs[i], ys[i]));
+      if (difference > worst)
+         worst = difference;
+   }
+   BENCH("tableLookup", POINTS, benchSink = tableLookup(plain, xs[i], ys[i]));
+   BENCH("tableLookup with coefficients", POINTS, benchSink = tableLookup(coefs, xs[i], ys[i]));
+   printf("  largest difference %.2g\n", worst);
+}
+
+int main() {
+   int x, y;
+
+   // something like what ecu.ino works PW out to be
+   for (y = 0; y < 16; y++)
+      for (x = 0; x < 16; x++)
+         dataPW[y][x] = dataVE[y][x] * 0.137f;
+
+   tableUseCoefs(&coefVE, coefsVE);
+   tableUseCoefs(&coefSA, coefsSA);
+   tableUseCoefs(&coefPW, coefsPW);
+   printf("coefficient RAM  VE: %d  SA: %d  PW: %d bytes\n",
+          (int)sizeof(coefsVE), (int)sizeof(coefsSA), (int)sizeof(coefsPW));
+
+   run("VE", &VETable, &coefVE);
+   run("SA", &SATable, &coefSA);
+   run("PW", &PWTable, &coefPW);
+   return 0;
+}
@@ -0,0 +1,72 @@
+//table_fixed.cpp
+//Sweeps the whole of the VE and SA tables in fine steps and gives the
+//largest difference between tableLookupFixed and tableLookup, against
+//FIXED_ERROR_BOUND, then times the two lookups on the same trace.
+//The host does float in hardware, so the time the fixed lookup saves
+//on the Due, where every float operation is a library call, is not shown here.
+#include "table.h"
+#include "tuning.h"
+#include "bench.h"
+
+#define X_STEP 0.37f
+#define Y_STEP 0.013f
+#define POINTS 2000000
+
+fixed_t fixedXs[POINTS], fixedYs[POINTS];
+float xs[POINTS], ys[POINTS];
+
+/*    This is a function used to sweep a table from end to end on both axes
+   and print the largest error of the fixed lookup. */
+static void sweep(const char *name, table_t *table, tablefx_t *fixed) {
+   float x, y, error, worst = 0;
+   long i, j, points = 0;
+
+   for (j = 0; (y = table->yVals[0] + j * Y_STEP) <= table->yVals[table->height - 1]; j++) {
+      for (i = 0; (x = table->xVals[0] + i * X_STEP) <= table->xVals[table->width - 1]; i++) {
+         error = fabsf(fixedToFloat(tableLookupFixed(fixed, floatToFixed(x), floatToFixed(y))) - tableLookup(table, x, y));
+         if (error > worst)
+            worst = error;
+         points++;
+      }
+   }
+   printf("%s: largest error %.2g over %ld points, bound %.2g%s\n", name, worst, points, FIXED_ERROR_BOUND,
+          worst > FIXED_ERROR_BOUND ? "  OVER THE BOUND" : "");
+}
+
+/* This is a function used to time both lookups of a table on a sweep trace. */
+static void run(table_t *table, tablefx_t *fixed) {
+   int i;
+
+   benchSweep(xs, ys, POINTS, table->xVals[0], table->xVals[table->width - 1],
+              table->yVals[0], table->yVals[table->height - 1]);
+   for (i = 0; i < POINTS; i++) {
+      fixedXs[i] = floatToFixed(xs[i]);
+      fixedYs[i] = floatToFixed(ys[i]);
+   }
+   BENCH("tableLookup", POINTS, benchSink = tableLookup(table, xs[i], ys[i]));
+   BENCH("tableLookupFixed", POINTS, benchSink = tableLookupFixed(fixed, fixedXs[i], fixedYs[i]));
+}
+
+fixed_t xFixedVE[16], yFixedVE[16], dataFixedVE[16 * 16];
+int32_t xRecipFixedVE[15], yRecipFixedVE[15];
+fixed_t xFixedSA[12], yFixedSA[12], dataFixedSA[12 * 12];
+int32_t xRecipFixedSA[11], yRecipFixedSA[11];
+
+int main() {
+   tablefx_t fixedVE = {xFixedVE, yFixedVE, dataFixedVE, xRecipFixedVE, yRecipFixedVE, 0, 0, 0, 0, 0};
+   tablefx_t fixedSA = {xFixedSA, yFixedSA, dataFixedSA, xRecipFixedSA, yRecipFixedSA, 0, 0, 0, 0, 0};
+
+   if (!tableToFixed(&VETable, &fixedVE) || !tableToFixed(&SATable, &fixedSA)) {
+      printf("tableToFixed failed\n");
+      return 1;
+   }
+
+   sweep("VE", &VETable, &fixedVE);
+   sweep("SA", &SATable, &fixedSA);
+
+   printf("VE, per lookup\n");
+   run(&VETable, &fixedVE);
+   printf("SA, per lookup\n");
+   run(&SATable, &fixedSA);
+   return 0;
+}
@@ -0,0 +1,60 @@
+//table_narrow.cpp
+//Gives the size of the VE and SA data stored narrow, as they are in
+//tunedata.h, against the same cells stored as floats, and times
+//lookups of each on a steady trace and a sweep.
+#include "table.h"
+#include "tuning.h"
+#include "bench.h"
+
+#define POINTS 2000000
+
+float xs[POINTS], ys[POINTS];
+float floatVE[16][16], floatSA[12][12];
+Table<16, 16> wideVE(xAxisVE, yAxisVE, xRecipVE, yRecipVE, floatVE, defaultVE);
+Table<12, 12> wideSA(xAxisSA, yAxisSA, xRecipSA, yRecipSA, floatSA, defaultSA);
+
+/*    This is a function used to time the narrow and float copies of a table
+   on the trace in xs and ys, and check they agree. */
+static void run(const char *trace, table_t *narrow, table_t *wide) {
+   char what[64];
+   float difference, worst = 0;
+   int i;
+
+   for (i = 0; i < POINTS; i++) {
+      difference = fabsf(tableLookup(narrow, xs[i], ys[i]) - tableLookup(wide, xs[i], ys[i]));
+      if (difference > worst)
+         worst = difference;
+   }
+   snprintf(what, sizeof(what), "%s, float data", trace);
+   BENCH(what, POINTS, benchSink = tableLookup(wide, xs[i], ys[i]));
+   snprintf(what, sizeof(what), "%s, narrow data", trace);
+   BENCH(what, POINTS, benchSink = tableLookup(narrow, xs[i], ys[i]));
+   printf("  largest difference %.2g\n", worst);
+}
+
+int main() {
+   int x, y;
+
+   for (y = 0; y < 16; y++)
+      for (x = 0; x < 16; x++)
+         floatVE[y][x] = getData(&VETable, x, y);
+   for (y = 0; y < 12; y++)
+      for (x = 0; x < 12; x++)
+         floatSA[y][x] = getData(&SATable, x, y);
+
+   printf("data bytes  VE: %d as float, %d as stored\n", (int)sizeof(floatVE), (int)sizeof(dataVE));
+   printf("            SA: %d as float, %d as stored\n", (int)sizeof(floatSA), (int)sizeof(dataSA));
+
+   printf("VE, per lookup\n");
+   benchSteady(xs, ys, POINTS, xAxisVE[0], xAxisVE[15], yAxisVE[0], yAxisVE[15]);
+   run("steady", &VETable, &wideVE);
+   benchSweep(xs, ys, POINTS, xAxisVE[0], xAxisVE[15], yAxisVE[0], yAxisVE[15]);
+   run("sweep", &VETable, &wideVE);
+
+   printf("SA, per lookup\n");
+   benchSteady(xs, ys, POINTS, xAxisSA[0], xAxisSA[11], yAxisSA[0], yAxisSA[11]);
+   run("steady", &SATable, &wideSA);
+   benchSweep(xs, ys, POINTS, xAxisSA[0], xAxisSA[11], yAxisSA[0], yAxisSA[11]);
+   run("sweep", &SATable, &wideSA);
+   return 0;
+}
@@ -0,0 +1,428 @@
+//tooth_isr.cpp
+//Counts the cycles tacISR takes on each tooth of a 12-1 wheel sweeping
+//from 1500 to 8000 rpm and back, as it was with float angles and a float
+//scheduleTooth window (copied below from before the change), and as it
+//is now, with integer teeth and delays, the timebase and the observer.
+//On the host float math is done in hardware, so this only shows the
+//work each ISR does. On the Due every float operation in the old ISR
+//was also a soft-float library call, tens of cycles each, and the new
+//one makes none.
+#include <algorithm>
+#include <vector>
+#include "scheduler.h"
+#include "observer.h"
+#include "timebase.h"
+#include "bench.h"
+
+#define CYCLES 4000      // engine cycles to run for
+#define NUM_TEETH 11     // teeth there, out of 12
+#define TOOTH_DEGREES 30
+#define LATENCY 40       // ticks from each edge to its ISR
+#define TRUE 1
+#define FALSE 0
+
+/* This is a helper function used to give the engine speed through a run. */
+static float rpmAt(int cycle) {
+   float t = (float)cycle / CYCLES;
+   return 1500 + 6500 * (t < 0.5f ? 2 * t : 2 - 2 * t);
+}
+
+/* This is the ISR before, with its scheduler, as far as the tooth ISR used them. */
+namespace before {
+
+#define CALIB_ANGLE 175.0f
+#define ANGLE_PER_TOOTH 30.0f
+#define TDC 360.0f
+#define DEGREES_PER_CYCLE 360.0f
+#define CALIBRATION_FACTOR 1.9f
+#define MAX_EVENTS 8
+
+typedef int (*eventaction_t)(int delay);
+
+typedef struct angleevent_t {
+   float angle;
+   eventaction_t action;
+} angleevent_t;
+
+typedef struct eventlist_t {
+   angleevent_t events[MAX_EVENTS];
+   int count;
+} eventlist_t;
+
+typedef struct scheduler_t {
+   eventlist_t lists[2];
+   eventlist_t *live;
+   eventlist_t *pending;
+   int next;
+   volatile char ready;
+} scheduler_t;
+
+volatile float engineSpeedDPMS;
+volatile float instantDPMS;
+volatile int teethPassed = 0;
+volatile char useFuel;
+volatile int lastTick, lastTickDelta, prevTick, prevTickDelta;
+volatile int lastRevEnd, lastRevDuration, prevRevEnd, prevRevDuration, prevPrevRevDuration;
+volatile float lastToothAngle;
+volatile float nextToothAngle;
+volatile char recalc;
+int messedUp, timesCalibrated, lastMessedUpToothCount;
+float lastMessedUpAngle;
+scheduler_t schedule;
+
+static void scheduleClear(scheduler_t *scheduler) {
+   scheduler->ready = 0;
+   scheduler->pending->count = 0;
+}
+
+static int scheduleAdd(scheduler_t *scheduler, float angle, eventaction_t action) {
+   eventlist_t *list = scheduler->pending;
+   int i;
+
+   if (list->count >= MAX_EVENTS) {
+      return 0;
+   }
+   for (i = list->count; i > 0 && list->events[i - 1].angle > angle; i--) {
+      list->events[i] = list->events[i - 1];
+   }
+   list->events[i].angle = angle;
+   list->events[i].action = action;
+   list->count++;
+   return 1;
+}
+
+static void schedulePublish(scheduler_t *scheduler) {
+   scheduler->ready = 1;
+}
+
+static void scheduleTooth(scheduler_t *scheduler, float from, float to, float toothAngle, unsigned long toothTime, float dpms) {
+   eventlist_t *list;
+   angleevent_t *event;
+   float nowAngle;
+
+   if (scheduler->ready) {
+      list = scheduler->live;
+      scheduler->live = scheduler->pending;
+      scheduler->pending = list;
+      scheduler->next = 0;
+      scheduler->ready = 0;
+   }
+
+   list = scheduler->live;
+   while (scheduler->next < list->count && list->events[scheduler->next].angle < from) {
+      scheduler->next++;
+   }
+
+   while (scheduler->next < list->count && list->events[scheduler->next].angle < to) {
+      event = &list->events[scheduler->next];
+      nowAngle = toothAngle + (micros() - toothTime) * dpms;
+      if (!event->action((event->angle - nowAngle) / dpms)) {
+         break;
+      }
+      scheduler->next++;
+   }
+}
+
+int armed;
+
+static int arm(int delay) {
+   benchSink = delay;
+   armed++;
+   return 1;
+}
+
+void tacISR()
+{
+   prevTick = lastTick;
+   lastTick = micros();
+
+   prevTickDelta = lastTickDelta;
+   lastTickDelta = lastTick - prevTick;
+
+   instantDPMS = ANGLE_PER_TOOTH / lastTickDelta;
+
+   if(lastTickDelta > prevTickDelta * CALIBRATION_FACTOR)
+   {
+      timesCalibrated++;
+      if(lastToothAngle != 120.0f)
+      {
+         messedUp++;
+         lastMessedUpAngle = lastToothAngle;
+         lastMessedUpToothCount = teethPassed;
+      }
+   }
+
+   ++teethPassed;
+
+   if(teethPassed >= NUM_TEETH)
+   {
+      teethPassed = 0;
+   }
+
+   if (lastTickDelta > prevTickDelta * CALIBRATION_FACTOR || teethPassed == 0) {
+      teethPassed = 0;
+      prevRevEnd = lastRevEnd;
+      lastRevEnd = lastTick;
+      prevPrevRevDuration = prevRevDuration;
+      prevRevDuration = lastRevDuration;
+      lastRevDuration = lastRevEnd - prevRevEnd;
+      lastToothAngle = CALIB_ANGLE;
+      engineSpeedDPMS = DEGREES_PER_CYCLE * 3.0f / (prevPrevRevDuration + prevRevDuration + lastRevDuration);
+      instantDPMS *= 2.0f;
+   }
+   else
+   {
+      lastToothAngle += ANGLE_PER_TOOTH;
+      if(lastToothAngle >= TDC)
+      {
+         recalc = TRUE;
+         lastToothAngle -= DEGREES_PER_CYCLE;
+         useFuel = !useFuel;
+      }
+   }
+
+   nextToothAngle = lastToothAngle + ANGLE_PER_TOOTH;
+   scheduleTooth(&schedule, nextToothAngle, nextToothAngle + ANGLE_PER_TOOTH, lastToothAngle, lastTick, instantDPMS);
+}
+
+/* This is what loop() did for the ISR once a cycle. */
+void plan() {
+   if (!recalc)
+      return;
+   scheduleClear(&schedule);
+   scheduleAdd(&schedule, 290, arm);
+   if (useFuel)
+      scheduleAdd(&schedule, 100, arm);
+   schedulePublish(&schedule);
+   recalc = FALSE;
+}
+
+void start() {
+   schedule.lists[0].count = 0;
+   schedule.lists[1].count = 0;
+   schedule.live = &schedule.lists[0];
+   schedule.pending = &schedule.lists[1];
+   lastToothAngle = CALIB_ANGLE;
+}
+
+#undef CALIB_ANGLE
+#undef ANGLE_PER_TOOTH
+#undef TDC
+#undef DEGREES_PER_CYCLE
+#undef CALIBRATION_FACTOR
+#undef MAX_EVENTS
+
+}
+
+/* This is the ISR now, as it is in ecu.ino, with the real scheduler and observer. */
+namespace after {
+
+#define CALIB_ANGLE angleDegrees(175)
+#define ANGLE_PER_TOOTH angleDegrees(30)
+#define TDC angleDegrees(360)
+#define DEGREES_PER_CYCLE angleDegrees(360)
+#define CALIBRATION_FACTOR 19
+
+volatile ticks_t revWindow, toothLatency;
+volatile int cycleTooth, teethPassed;
+volatile char useFuel, recalc;
+volatile stamp_t lastTick, prevTick, lastRevEnd, prevRevEnd;
+volatile ticks_t lastTickDelta, prevTickDelta, lastRevDuration, prevRevDuration, prevPrevRevDuration;
+volatile angle_t lastToothAngle;
+int messedUp, timesCalibrated, lastMessedUpToothCount;
+angle_t lastMessedUpAngle;
+scheduler_t schedule;
+crankobserver_t observer;
+angle_t toothAngles[NUM_TEETH];
+int armedCycle[2] = {-1, -1};
+int armed;
+
+static void armSpark(ticks_t delay) {
+   if (armedCycle[0] == schedule.cycle)
+      return;
+   armedCycle[0] = schedule.cycle;
+   benchSink = delay.raw;
+   armed++;
+}
+
+static void armFuel(ticks_t delay) {
+   if (armedCycle[1] == schedule.cycle)
+      return;
+   armedCycle[1] = schedule.cycle;
+   benchSink = delay.raw;
+   armed++;
+}
+
+void tacISR()
+{
+   ticks_t held;
+
+   prevTick = lastTick;
+   lastTick = timebaseCaptured();
+   held = timebaseNow() - lastTick;
+   if (held > toothLatency)
+      toothLatency = held;
+
+   prevTickDelta = lastTickDelta;
+   lastTickDelta = lastTick - prevTick;
+
+   if(lastTickDelta.raw * 10 > prevTickDelta.raw * CALIBRATION_FACTOR)
+   {
+      timesCalibrated++;
+      if(lastToothAngle != angleDegrees(120))
+      {
+         messedUp++;
+         lastMessedUpAngle = lastToothAngle;
+         lastMessedUpToothCount = teethPassed;
+      }
+   }
+
+   ++teethPassed;
+
+   if(teethPassed >= NUM_TEETH)
+   {
+      teethPassed = 0;
+   }
+
+   ++cycleTooth;
+
+   if (lastTickDelta.raw * 10 > prevTickDelta.raw * CALIBRATION_FACTOR || teethPassed == 0) {
+      teethPassed = 0;
+      prevRevEnd = lastRevEnd;
+      lastRevEnd = lastTick;
+      prevPrevRevDuration = prevRevDuration;
+      prevRevDuration = lastRevDuration;
+      lastRevDuration = lastRevEnd - prevRevEnd;
+      lastToothAngle = CALIB_ANGLE;
+      revWindow = prevPrevRevDuration + prevRevDuration + lastRevDuration;
+   }
+   else
+   {
+      lastToothAngle = lastToothAngle + ANGLE_PER_TOOTH;
+      if(lastToothAngle >= TDC)
+      {
+         recalc = TRUE;
+         lastToothAngle = lastToothAngle - DEGREES_PER_CYCLE;
+         useFuel = !useFuel;
+         cycleTooth = 0;
+         scheduleCycle(&schedule);
+      }
+   }
+
+   observerTooth(&observer, lastTick, lastToothAngle);
+
+   scheduleTooth(&schedule, cycleTooth);
+}
+
+/* This is what loop() does for the ISR once a cycle. */
+void plan() {
+   while (observerPending(&observer))
+      observerRun(&observer);
+   if (!recalc || !observerReady(&observer))
+      return;
+   scheduleClear(&schedule);
+   scheduleAdd(&schedule, angleDegrees(290), &observer, armSpark);
+   if (useFuel)
+      scheduleAdd(&schedule, angleDegrees(100), &observer, armFuel);
+   schedulePublish(&schedule);
+   recalc = FALSE;
+}
+
+void start() {
+   int i, first = 0;
+
+   // the same as setup() in ecu.ino
+   while (first < NUM_TEETH && CALIB_ANGLE + first * ANGLE_PER_TOOTH < TDC)
+      first++;
+   for (i = 0; i < NUM_TEETH; i++) {
+      toothAngles[i] = CALIB_ANGLE + ((first + i) % NUM_TEETH) * ANGLE_PER_TOOTH;
+      if (toothAngles[i] >= TDC)
+         toothAngles[i] -= DEGREES_PER_CYCLE;
+   }
+   schedulerInit(&schedule, toothAngles, NUM_TEETH, ANGLE_PER_TOOTH);
+   observerInit(&observer, NUM_TEETH, DEGREES_PER_CYCLE);
+   lastToothAngle = CALIB_ANGLE;
+   tcMockReset();
+   timebaseStart(2, RISING);
+}
+
+#undef CALIB_ANGLE
+#undef ANGLE_PER_TOOTH
+#undef TDC
+#undef DEGREES_PER_CYCLE
+#undef CALIBRATION_FACTOR
+
+}
+
+/*    This is a function used to print the typical tooth, the worst kind of
+   tooth (the one with the most typical cycles, by where it is in the cycle),
+   and the single worst, which also has whatever the host got up to in it. */
+static void report(const char *name, std::vector<unsigned long long> &cycles, std::vector<int> &kinds, int armed) {
+   std::vector<unsigned long long> sorted, kind;
+   unsigned long long median, worstKind = 0;
+   int k, worstAt = 0;
+   size_t i;
+
+   for (k = 0; k < NUM_TEETH; k++) {
+      kind.clear();
+      for (i = 0; i < cycles.size(); i++) {
+         if (kinds[i] == k)
+            kind.push_back(cycles[i]);
+      }
+      std::sort(kind.begin(), kind.end());
+      if (!kind.empty() && kind[kind.size() / 2] > worstKind) {
+         worstKind = kind[kind.size() / 2];
+         worstAt = k;
+      }
+   }
+   sorted = cycles;
+   std::sort(sorted.begin(), sorted.end());
+   median = sorted[sorted.size() / 2];
+   printf("  %-8s typical %4llu cycles, worst tooth (%d) %4llu, 99.9%% %4llu, single worst %llu, %d events armed\n",
+          name, median, worstAt, worstKind, sorted[sorted.size() * 999 / 1000], sorted.back(), armed);
+}
+
+int main() {
+   std::vector<unsigned long long> oldCycles, newCycles;
+   std::vector<int> kinds;   // teeth since TDC, the same for both
+   TcChannel *channel = TICK_CHANNEL::channel();
+   unsigned long long t;
+   double micro = 0;
+   uint32_t period;
+   int cycle, tooth, gap;
+
+   before::start();
+   after::start();
+   for (cycle = 0; cycle < CYCLES; cycle++) {
+      for (tooth = 0; tooth < NUM_TEETH; tooth++) {
+         // the tooth after the missing one comes two teeth late
+         gap = tooth == 5 ? 2 : 1;
+         period = (uint32_t)(gap * CAPTURE_FREQUENCY * 60.0f / (rpmAt(cycle) * 360 / TOOTH_DEGREES));
+
+         micro += period * 1e6 / CAPTURE_FREQUENCY;
+         mockMicros = (unsigned long)micro;
+         t = benchCycles();
+         before::tacISR();
+         oldCycles.push_back(benchCycles() - t);
+         before::plan();
+
+         tcMockCount(channel, period - LATENCY);
+         tcMockEdge(channel, 1);
+         tcMockCount(channel, LATENCY);
+         if (channel->TC_SR & TIMEBASE_STATUS)
+            timebaseNow();
+         tcMockStatus(channel);
+         t = benchCycles();
+         after::tacISR();
+         newCycles.push_back(benchCycles() - t);
+         kinds.push_back((int)after::cycleTooth);
+         tcMockEdge(channel, 0);
+         after::plan();
+      }
+   }
+
+   printf("tacISR per tooth, in host cycles, with teeth counted from TDC\n");
+   report("before", oldCycles, kinds, before::armed);
+   report("after", newCycles, kinds, after::armed);
+   return 0;
+}
@@ -0,0 +1,48 @@
+//check.h
+//A few macros for the host tests. Each test is its own program,
+//which checks as it goes and returns how many checks failed.
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <math.h>
+
+static int checksRun;
+static int checksFailed;
+
+/*  This checks that cond is true, and prints where it was if it is not. */
+#define CHECK(cond) checkThat((cond), #cond, __FILE__, __LINE__)
+
+/*  This checks that a is within tolerance of b. */
+#define CHECK_NEAR(a, b, tolerance) checkNear((double)(a), (double)(b), (double)(tolerance), #a, #b, __FILE__, __LINE__)
+
+static inline int checkThat(int ok, const char *what, const char *file, int line) {
+   checksRun++;
+   if (!ok) {
+      checksFailed++;
+      if (checksFailed <= 20)
+         printf("%s:%d: failed: %s\n", file, line, what);
+   }
+   return ok;
+}
+
+static inline int checkNear(double a, double b, double tolerance, const char *aText, const char *bText,
+                            const char *file, int line) {
+   checksRun++;
+   if (!(fabs(a - b) <= tolerance)) {
+      checksFailed++;
+      if (checksFailed <= 20)
+         printf("%s:%d: failed: %s = %.9g, %s = %.9g, more than %.3g apart\n", file, line, aText, a, bText, b, tolerance);
+      return 0;
+   }
+   return 1;
+}
+
+/*    This is a function used to print how the checks went,
+   for main() to return. */
+static inline int checkReport(const char *name) {
+   printf("%s: %d checks, %d failed\n", name, checksRun, checksFailed);
+   return checksFailed ? 1 : 0;
+}
+
+#endif
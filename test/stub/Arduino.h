@@ -0,0 +1,80 @@
+//Arduino.h
+//Host stand-in for the Arduino Due core, so the ECU and DueTimer
+//can be built and tested on a PC. Only what they use is here.
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sam.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define A3 57
+#define HEX 16
+
+#define VARIANT_MCK 84000000
+
+#ifndef abs
+#define abs(x) ((x) > 0 ? (x) : -(x))
+#endif
+
+/*  This is the serial port. Nothing is sent anywhere,
+   but it counts what was printed, and availableForWrite
+   says how much room the Due's transmit buffer would have. */
+#define SERIAL_BUFFER_SIZE 128
+
+struct SerialStub {
+   unsigned long written;   // bytes printed so far
+   int room;                // what availableForWrite gives
+
+   void begin(long) {}
+   int availableForWrite() { return room; }
+   size_t print(const char *s) { return count(strlen(s)); }
+   size_t print(char c) { (void)c; return count(1); }
+   size_t print(long n, int base = 10) { return count(digits(n, base)); }
+   size_t print(int n, int base = 10) { return print((long)n, base); }
+   size_t print(unsigned long n, int base = 10) { return print((long)n, base); }
+   size_t print(unsigned int n, int base = 10) { return print((long)n, base); }
+   size_t print(double n, int places = 2) { return count(digits((long)n, 10) + 1 + places); }
+   size_t println() { return count(2); }
+   template <typename T> size_t println(T value) { return print(value) + println(); }
+   template <typename T> size_t println(T value, int format) { return print(value, format) + println(); }
+
+   size_t count(size_t n) { written += n; return n; }
+   static size_t digits(long n, int base) {
+      size_t d = n < 0 ? 2 : 1;
+      for (n /= base; n; n /= base) d++;
+      return d;
+   }
+};
+
+extern SerialStub Serial;
+
+/*  These are the pins. Writes are remembered so tests can read them back. */
+extern int pinValues[];
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+int analogRead(uint32_t pin);
+void attachInterrupt(uint32_t pin, void (*isr)(void), uint32_t mode);
+
+/*  Time only moves when a test moves it, with mockMicros. */
+extern unsigned long mockMicros;
+
+unsigned long micros(void);
+unsigned long millis(void);
+void delay(unsigned long ms);
+
+#endif
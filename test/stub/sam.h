@@ -0,0 +1,191 @@
+//sam.h
+//Host stand-in for the SAM3X registers and CMSIS calls that DueTimer
+//and the ECU use. The timer counters are plain structs, and the tcMock
+//functions below play the part of the hardware: they move the counter,
+//latch captures and set status bits the way the SAM3X datasheet says
+//the Timer Counter does, so capture and overflow handling can be tested.
+#ifndef SAM_H
+#define SAM_H
+
+#include <stdint.h>
+
+/*  This is one timer channel, with the registers the code touches.
+   Writes to TC_CCR, TC_IER and TC_IDR only take effect
+   when the next tcMock function runs, and TC_SR is not cleared
+   by reading it, so use tcMockStatus for that. */
+typedef struct TcChannel {
+   volatile uint32_t TC_CCR;
+   volatile uint32_t TC_CMR;
+   volatile uint32_t TC_SMMR;
+   volatile uint32_t TC_CV;
+   volatile uint32_t TC_RA;
+   volatile uint32_t TC_RB;
+   volatile uint32_t TC_RC;
+   volatile uint32_t TC_SR;
+   volatile uint32_t TC_IER;
+   volatile uint32_t TC_IDR;
+   volatile uint32_t TC_IMR;
+
+   // hardware state that is not a register
+   char clockOn;
+   char tioa;        // level of the TIOA line
+   char loadedA;     // RA was loaded since the last trigger or RB load
+} TcChannel;
+
+typedef struct Tc {
+   TcChannel TC_CHANNEL[3];
+} Tc;
+
+extern Tc tcMock[3];
+
+#define TC0 (&tcMock[0])
+#define TC1 (&tcMock[1])
+#define TC2 (&tcMock[2])
+
+typedef enum IRQn_Type {
+   UART_IRQn = 8,
+   PIOA_IRQn = 11,
+   PIOB_IRQn = 12,
+   PIOC_IRQn = 13,
+   PIOD_IRQn = 14,
+   TC0_IRQn = 27,
+   TC1_IRQn,
+   TC2_IRQn,
+   TC3_IRQn,
+   TC4_IRQn,
+   TC5_IRQn,
+   TC6_IRQn,
+   TC7_IRQn,
+   TC8_IRQn,
+   NUM_IRQn
+} IRQn_Type;
+
+/*  These are the timer handlers, which the real header declares too. */
+void TC0_Handler(void);
+void TC1_Handler(void);
+void TC2_Handler(void);
+void TC3_Handler(void);
+void TC4_Handler(void);
+void TC5_Handler(void);
+void TC6_Handler(void);
+void TC7_Handler(void);
+void TC8_Handler(void);
+
+#define TC_CCR_CLKEN (0x1u << 0)
+#define TC_CCR_CLKDIS (0x1u << 1)
+#define TC_CCR_SWTRG (0x1u << 2)
+
+#define TC_CMR_TCCLKS_TIMER_CLOCK1 (0x0u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK2 (0x1u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK3 (0x2u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK4 (0x3u << 0)
+#define TC_CMR_CPCSTOP (0x1u << 6)
+#define TC_CMR_EEVT_XC0 (0x1u << 10)
+#define TC_CMR_WAVSEL_UP (0x0u << 13)
+#define TC_CMR_WAVSEL_UP_RC (0x2u << 13)
+#define TC_CMR_WAVE (0x1u << 15)
+#define TC_CMR_LDRA_Msk (0x3u << 16)
+#define TC_CMR_LDRA_RISING (0x1u << 16)
+#define TC_CMR_LDRA_FALLING (0x2u << 16)
+#define TC_CMR_LDRA_EDGE (0x3u << 16)
+#define TC_CMR_LDRB_Msk (0x3u << 18)
+#define TC_CMR_LDRB_RISING (0x1u << 18)
+#define TC_CMR_LDRB_FALLING (0x2u << 18)
+#define TC_CMR_LDRB_EDGE (0x3u << 18)
+#define TC_CMR_ACPA_SET (0x1u << 16)
+#define TC_CMR_ACPC_CLEAR (0x2u << 18)
+#define TC_CMR_ASWTRG_CLEAR (0x2u << 22)
+#define TC_CMR_BCPB_SET (0x1u << 24)
+#define TC_CMR_BCPC_CLEAR (0x2u << 26)
+#define TC_CMR_BSWTRG_CLEAR (0x2u << 30)
+
+#define TC_SR_COVFS (0x1u << 0)
+#define TC_SR_LOVRS (0x1u << 1)
+#define TC_SR_CPAS (0x1u << 2)
+#define TC_SR_CPBS (0x1u << 3)
+#define TC_SR_CPCS (0x1u << 4)
+#define TC_SR_LDRAS (0x1u << 5)
+#define TC_SR_LDRBS (0x1u << 6)
+
+#define TC_IER_COVFS TC_SR_COVFS
+#define TC_IER_CPAS TC_SR_CPAS
+#define TC_IER_CPBS TC_SR_CPBS
+#define TC_IER_CPCS TC_SR_CPCS
+#define TC_IER_LDRAS TC_SR_LDRAS
+#define TC_IER_LDRBS TC_SR_LDRBS
+#define TC_IMR_COVFS TC_SR_COVFS
+#define TC_IMR_CPCS TC_SR_CPCS
+#define TC_IMR_LDRAS TC_SR_LDRAS
+#define TC_IMR_LDRBS TC_SR_LDRBS
+
+void TC_Configure(Tc *tc, uint32_t channel, uint32_t mode);
+void TC_Start(Tc *tc, uint32_t channel);
+void TC_Stop(Tc *tc, uint32_t channel);
+void TC_SetRA(Tc *tc, uint32_t channel, uint32_t ra);
+void TC_SetRB(Tc *tc, uint32_t channel, uint32_t rb);
+void TC_SetRC(Tc *tc, uint32_t channel, uint32_t rc);
+uint32_t TC_GetStatus(Tc *tc, uint32_t channel);
+
+/*    This is a function used to count a channel on by ticks.
+   In capture mode it wraps after 2^32 and sets COVFS.
+   In waveform mode it sets CPAS, CPBS and CPCS as it passes RA, RB and RC,
+   and stops at RC if CPCSTOP is set. */
+void tcMockCount(TcChannel *channel, uint32_t ticks);
+
+/*    This is a function used to change the level of a channel's TIOA line.
+   A matching edge loads RA or RB the way the datasheet says:
+   RA only if it has not been loaded since the last trigger or the last RB load,
+   and RB only if RA has been loaded since then. */
+void tcMockEdge(TcChannel *channel, int level);
+
+/*    This is a function used to read and clear the status, the way
+   reading TC_SR does on the real part. */
+uint32_t tcMockStatus(TcChannel *channel);
+
+/*    This is a function used to put every timer back the way it was at reset. */
+void tcMockReset(void);
+
+/*  These stand in for the interrupt controller.
+   Priorities and enables are remembered so tests can check them. */
+extern uint32_t nvicMockPriority[NUM_IRQn];
+extern char nvicMockEnabled[NUM_IRQn];
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+uint32_t NVIC_GetPriority(IRQn_Type irq);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+
+/*  The PRIMASK calls just remember whether interrupts are off. */
+extern uint32_t primaskMock;
+
+inline uint32_t __get_PRIMASK(void) { return primaskMock; }
+inline void __set_PRIMASK(uint32_t primask) { primaskMock = primask; }
+inline void __disable_irq(void) { primaskMock = 1; }
+inline void __enable_irq(void) { primaskMock = 0; }
+
+void pmc_set_writeprotect(uint32_t enable);
+uint32_t pmc_enable_periph_clk(uint32_t id);
+
+/*  This is the part of the Due's pin table that DueTimer reads.
+   ulTCChannel is 2 * timer for a TIOA line and 2 * timer + 1 for TIOB. */
+typedef struct PinDescription {
+   void *pPort;
+   uint32_t ulPin;
+   uint32_t ulPeripheralId;
+   int ulPinType;
+   uint32_t ulPinConfiguration;
+   int ulTCChannel;
+} PinDescription;
+
+#define NOT_ON_TIMER -1
+
+extern const PinDescription g_APinDescription[];
+
+/*  This is how many times PIO_Configure was called, so tests can see
+   when a pin is handed to a timer. */
+extern int pioMockConfigures;
+
+uint32_t PIO_Configure(void *pio, int type, uint32_t mask, uint32_t attribute);
+
+#endif
@@ -0,0 +1,206 @@
+//stub.cpp
+//Host stand-in for the Arduino Due core and the SAM3X timers.
+#include "Arduino.h"
+
+SerialStub Serial = {0, SERIAL_BUFFER_SIZE - 1};
+int pinValues[80];
+unsigned long mockMicros;
+
+Tc tcMock[3];
+uint32_t nvicMockPriority[NUM_IRQn];
+char nvicMockEnabled[NUM_IRQn];
+uint32_t primaskMock;
+int pioMockConfigures;
+
+/*  This is the start of the Due's pin table, with each pin's timer line. */
+const PinDescription g_APinDescription[] = {
+   {0, 0, PIOA_IRQn, 0, 0, NOT_ON_TIMER},   // 0
+   {0, 0, PIOA_IRQn, 0, 0, NOT_ON_TIMER},   // 1
+   {0, 0, PIOB_IRQn, 0, 0, 0},              // 2, TIOA0
+   {0, 0, PIOC_IRQn, 0, 0, 14},             // 3, TIOA7
+   {0, 0, PIOC_IRQn, 0, 0, 13},             // 4, TIOB6
+   {0, 0, PIOC_IRQn, 0, 0, 12},             // 5, TIOA6
+   {0, 0, PIOC_IRQn, 0, 0, NOT_ON_TIMER},   // 6
+   {0, 0, PIOC_IRQn, 0, 0, NOT_ON_TIMER},   // 7
+   {0, 0, PIOC_IRQn, 0, 0, NOT_ON_TIMER},   // 8
+   {0, 0, PIOC_IRQn, 0, 0, NOT_ON_TIMER},   // 9
+   {0, 0, PIOC_IRQn, 0, 0, 15},             // 10, TIOB7
+   {0, 0, PIOD_IRQn, 0, 0, 16},             // 11, TIOA8
+   {0, 0, PIOD_IRQn, 0, 0, 17},             // 12, TIOB8
+   {0, 0, PIOB_IRQn, 0, 0, 1},              // 13, TIOB0
+};
+
+void pinMode(uint32_t, uint32_t) {}
+void digitalWrite(uint32_t pin, uint32_t value) { pinValues[pin] = value; }
+int digitalRead(uint32_t pin) { return pinValues[pin]; }
+int analogRead(uint32_t) { return 0; }
+void attachInterrupt(uint32_t, void (*)(void), uint32_t) {}
+
+unsigned long micros(void) { return mockMicros; }
+unsigned long millis(void) { return mockMicros / 1000; }
+void delay(unsigned long ms) { mockMicros += ms * 1000; }
+
+/* This is a helper function used to apply the register writes
+   that the real part acts on straight away. */
+static void tcMockSync(TcChannel *channel) {
+   if (channel->TC_CCR & TC_CCR_CLKDIS)
+      channel->clockOn = 0;
+   else if (channel->TC_CCR & TC_CCR_CLKEN)
+      channel->clockOn = 1;
+   if (channel->TC_CCR & TC_CCR_SWTRG) {
+      channel->TC_CV = 0;
+      channel->loadedA = 0;
+   }
+   channel->TC_CCR = 0;
+
+   channel->TC_IMR |= channel->TC_IER;
+   channel->TC_IMR &= ~channel->TC_IDR;
+   channel->TC_IER = 0;
+   channel->TC_IDR = 0;
+}
+
+void TC_Configure(Tc *tc, uint32_t channel, uint32_t mode) {
+   TcChannel *c = &tc->TC_CHANNEL[channel];
+
+   tcMockSync(c);
+   c->clockOn = 0;
+   c->TC_IMR = 0;
+   c->TC_SR = 0;
+   c->TC_CMR = mode;
+}
+
+void TC_Start(Tc *tc, uint32_t channel) {
+   tc->TC_CHANNEL[channel].TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+   tcMockSync(&tc->TC_CHANNEL[channel]);
+}
+
+void TC_Stop(Tc *tc, uint32_t channel) {
+   tc->TC_CHANNEL[channel].TC_CCR = TC_CCR_CLKDIS;
+   tcMockSync(&tc->TC_CHANNEL[channel]);
+}
+
+void TC_SetRA(Tc *tc, uint32_t channel, uint32_t ra) {
+   tc->TC_CHANNEL[channel].TC_RA = ra;
+}
+
+void TC_SetRB(Tc *tc, uint32_t channel, uint32_t rb) {
+   tc->TC_CHANNEL[channel].TC_RB = rb;
+}
+
+void TC_SetRC(Tc *tc, uint32_t channel, uint32_t rc) {
+   tc->TC_CHANNEL[channel].TC_RC = rc;
+}
+
+uint32_t TC_GetStatus(Tc *tc, uint32_t channel) {
+   return tcMockStatus(&tc->TC_CHANNEL[channel]);
+}
+
+/*    This is a function used to count a channel on by ticks. */
+void tcMockCount(TcChannel *channel, uint32_t ticks) {
+   uint64_t count, last;
+
+   tcMockSync(channel);
+   if (!channel->clockOn)
+      return;
+
+   count = (uint64_t)channel->TC_CV + ticks;
+   if (!(channel->TC_CMR & TC_CMR_WAVE)) {
+      if (count >> 32)
+         channel->TC_SR |= TC_SR_COVFS;
+      // RC still compares in capture mode, it just does not trigger
+      if ((channel->TC_CV < channel->TC_RC && count >= channel->TC_RC) || count >= ((uint64_t)1 << 32) + channel->TC_RC)
+         channel->TC_SR |= TC_SR_CPCS;
+      channel->TC_CV = (uint32_t)count;
+      return;
+   }
+
+   // a counter that stops at RC never gets to a compare past it
+   last = count;
+   if (channel->TC_RC && (channel->TC_CMR & TC_CMR_CPCSTOP) && last > channel->TC_RC)
+      last = channel->TC_RC;
+   if (channel->TC_RA && channel->TC_CV < channel->TC_RA && last >= channel->TC_RA)
+      channel->TC_SR |= TC_SR_CPAS;
+   if (channel->TC_RB && channel->TC_CV < channel->TC_RB && last >= channel->TC_RB)
+      channel->TC_SR |= TC_SR_CPBS;
+
+   if (channel->TC_RC && count >= channel->TC_RC) {
+      channel->TC_SR |= TC_SR_CPCS;
+      if (channel->TC_CMR & TC_CMR_CPCSTOP) {
+         channel->TC_CV = channel->TC_RC;
+         channel->clockOn = 0;
+         return;
+      }
+      if ((channel->TC_CMR & (0x3u << 13)) == TC_CMR_WAVSEL_UP_RC)
+         count %= channel->TC_RC;
+   }
+   channel->TC_CV = (uint32_t)count;
+}
+
+/* This is a helper function used to see if an LDRA or LDRB setting
+   picks out this edge. */
+static int tcMockMatch(uint32_t select, int rising) {
+   return select == 3 || (select == 1 && rising) || (select == 2 && !rising);
+}
+
+/*    This is a function used to change the level of a channel's TIOA line. */
+void tcMockEdge(TcChannel *channel, int level) {
+   int rising;
+
+   tcMockSync(channel);
+   level = level ? 1 : 0;
+   if (level == channel->tioa)
+      return;
+   channel->tioa = level;
+   rising = level;
+
+   if ((channel->TC_CMR & TC_CMR_WAVE) || !channel->clockOn)
+      return;
+
+   if (tcMockMatch((channel->TC_CMR >> 16) & 3, rising) && !channel->loadedA) {
+      if (channel->TC_SR & TC_SR_LDRAS)
+         channel->TC_SR |= TC_SR_LOVRS;
+      channel->TC_RA = channel->TC_CV;
+      channel->TC_SR |= TC_SR_LDRAS;
+      channel->loadedA = 1;
+   }
+   else if (tcMockMatch((channel->TC_CMR >> 18) & 3, rising) && channel->loadedA) {
+      if (channel->TC_SR & TC_SR_LDRBS)
+         channel->TC_SR |= TC_SR_LOVRS;
+      channel->TC_RB = channel->TC_CV;
+      channel->TC_SR |= TC_SR_LDRBS;
+      channel->loadedA = 0;
+   }
+}
+
+/*    This is a function used to read and clear the status. */
+uint32_t tcMockStatus(TcChannel *channel) {
+   uint32_t status;
+
+   tcMockSync(channel);
+   status = channel->TC_SR;
+   channel->TC_SR = 0;
+   return status;
+}
+
+/*    This is a function used to put every timer back the way it was at reset. */
+void tcMockReset(void) {
+   memset(tcMock, 0, sizeof(tcMock));
+   memset(nvicMockPriority, 0, sizeof(nvicMockPriority));
+   memset(nvicMockEnabled, 0, sizeof(nvicMockEnabled));
+   primaskMock = 0;
+   pioMockConfigures = 0;
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) { nvicMockPriority[irq] = priority & 15; }
+uint32_t NVIC_GetPriority(IRQn_Type irq) { return nvicMockPriority[irq]; }
+void NVIC_EnableIRQ(IRQn_Type irq) { nvicMockEnabled[irq] = 1; }
+void NVIC_DisableIRQ(IRQn_Type irq) { nvicMockEnabled[irq] = 0; }
+void NVIC_ClearPendingIRQ(IRQn_Type) {}
+
+void pmc_set_writeprotect(uint32_t) {}
+uint32_t pmc_enable_periph_clk(uint32_t) { return 0; }
+
+uint32_t PIO_Configure(void *, int, uint32_t, uint32_t) {
+   pioMockConfigures++;
+   return 1;
+}
@@ -0,0 +1,105 @@
+//test_duetimer.cpp
+//Checks DueTimer's counting modes against the mock Timer Counter in stub/.
+#include <Arduino.h>
+#include "DueTimer.h"
+#include "check.h"
+
+// Timer3 is the first channel of TC1
+#define TIMER3_CHANNEL (&TC1->TC_CHANNEL[0])
+
+// pin 2 is TIOA0, the line Timer0 captures on
+#define CAPTURE_PIN 2
+#define TEETH 50
+
+/*    This is a function used to check that a timer counting ticks
+   reports the frequency and period the ticks work out to. */
+static void checkTicks() {
+   uint32_t mode;
+
+   tcMockReset();
+   Timer3.setTickClock(32).startTicks(2625);
+   CHECK_NEAR(Timer3.getFrequency(), 1000, 1e-9);
+   CHECK(Timer3.getPeriod() == 1000);
+   CHECK((TIMER3_CHANNEL->TC_CMR & 3) == TC_CMR_TCCLKS_TIMER_CLOCK3);
+
+   Timer3.startTicks(42);
+   CHECK_NEAR(Timer3.getFrequency(), 84e6 / 32 / 42, 1e-6);
+   CHECK(Timer3.getPeriod() == 16);
+
+   Timer3.setTickClock(2).startTicks(84);
+   CHECK_NEAR(Timer3.getFrequency(), 500000, 1e-6);
+   CHECK(Timer3.getPeriod() == 2);
+
+   // start() keeps the ticks instead of setting its own frequency
+   Timer3.stop().start();
+   CHECK(TIMER3_CHANNEL->TC_RC == 84);
+   CHECK_NEAR(Timer3.getFrequency(), 500000, 1e-6);
+
+   // a divisor the timer does not have leaves it alone
+   mode = TIMER3_CHANNEL->TC_CMR;
+   Timer3.setTickClock(64);
+   CHECK(TIMER3_CHANNEL->TC_CMR == mode);
+   CHECK_NEAR(Timer3.getFrequency(), 500000, 1e-6);
+
+   // and setting a frequency goes back to it
+   Timer3.setFrequency(250);
+   CHECK_NEAR(Timer3.getFrequency(), 250, 1e-6);
+   CHECK(Timer3.getPeriod() == 4000);
+}
+
+int stockCalls;
+
+/* This is a helper function used as the callback of a timer that is not bound. */
+static void stockCallback() {
+   stockCalls++;
+}
+
+/*    This is a function used to check that a timer the ECU does not bind
+   still has DueTimer's own handler, which calls what attachInterrupt set. */
+static void checkStockHandler() {
+   tcMockReset();
+   stockCalls = 0;
+   Timer3.attachInterrupt(stockCallback).setTickClock(32).startTicks(100);
+   TC3_Handler();
+   CHECK(stockCalls == 1);
+   Timer3.detachInterrupt();
+}
+
+/*    This is a function used to run a square wave into Timer0's capture
+   line, and check that every edge the mode asks for interrupts
+   with its own count, and no other edge does. */
+static void checkCapture(uint32_t mode) {
+   TcChannel *channel = DueTimerChannel<0>::channel();
+   uint32_t status, edgeCount;
+   int tooth, level;
+
+   tcMockReset();
+   Timer0.startCapture(CAPTURE_PIN, mode);
+   for (tooth = 0; tooth < TEETH; tooth++) {
+      for (level = 1; level >= 0; level--) {
+         // a little further each time, so every count is different
+         tcMockCount(channel, 1000 + tooth * 7 + level);
+         edgeCount = channel->TC_CV;
+         tcMockEdge(channel, level);
+         tcMockCount(channel, 3);
+         status = tcMockStatus(channel) & channel->TC_IMR;
+         if (mode == CHANGE || (mode == RISING) == (level == 1)) {
+            CHECK(status != 0);
+            CHECK(Timer0.getCapture() == edgeCount);
+            CHECK(DueTimerChannel<0>::capture() == edgeCount);
+         }
+         else {
+            CHECK(status == 0);
+         }
+      }
+   }
+}
+
+int main() {
+   checkTicks();
+   checkStockHandler();
+   checkCapture(RISING);
+   checkCapture(FALLING);
+   checkCapture(CHANGE);
+   return checkReport("duetimer");
+}
@@ -0,0 +1,159 @@
+//test_scheduler.cpp
+//Checks that events planned again after every tooth, the way loop()
+//plans them, are armed once a cycle, even when a newer plan moves one
+//onto a tooth that has already gone by, and that the observer puts
+//a time back on the crank where it was.
+#include "scheduler.h"
+#include "check.h"
+
+#define TEETH 12
+#define TOOTH_TICKS 1000
+#define LEAD angleDegrees(5)
+
+angle_t toothAngles[TEETH];
+scheduler_t schedule;
+crankobserver_t observer;
+stamp_t now;
+int tooth;
+int armed;           // times the event has been armed
+int armedCycle;      // schedule cycle it was last armed in
+int armedTooth;      // tooth it was last armed on
+ticks_t armedDelay;  // delay it was last armed with
+
+/* This is a helper function used as the event's action.
+   Like chargeSpark, it only acts once a cycle. */
+static void arm(ticks_t delay) {
+   if (armedCycle == schedule.cycle)
+      return;
+   armedCycle = schedule.cycle;
+   armed++;
+   armedTooth = tooth;
+   armedDelay = delay;
+}
+
+/*    This is a function used to play the tooth ISR for the next tooth,
+   with the crank turning at a steady TOOTH_TICKS a tooth. */
+static void nextTooth() {
+   now = now + ticks_t(TOOTH_TICKS);
+   if (++tooth == TEETH) {
+      tooth = 0;
+      scheduleCycle(&schedule);
+   }
+   observerTooth(&observer, now, toothAngles[tooth]);
+   scheduleTooth(&schedule, tooth);
+}
+
+/*    This is a function used to play loop() planning the event at angle. */
+static void plan(angle_t angle) {
+   scheduleClear(&schedule);
+   observerRun(&observer);
+   scheduleAdd(&schedule, angle, &observer, arm);
+   schedulePublish(&schedule);
+}
+
+/*    This is a function used to start over with the crank at tooth 0,
+   after enough steady teeth for the observer to be ready. */
+static void start() {
+   int i;
+
+   schedulerInit(&schedule, toothAngles, TEETH, LEAD);
+   observerInit(&observer, TEETH, angleDegrees(360));
+   now = stamp_t(0);
+   tooth = TEETH - 1;
+   for (i = 0; i <= 3 * TEETH; i++) {
+      nextTooth();
+      observerRun(&observer);
+   }
+   CHECK(observerReady(&observer));
+   CHECK(tooth == 0);
+   armed = 0;
+   armedCycle = -1;
+}
+
+/*    This is a function used to check a plan that stays put. */
+static void checkSteady() {
+   int i;
+
+   start();
+   for (i = 0; i < TEETH - 1; i++) {
+      plan(angleDegrees(190));
+      nextTooth();
+   }
+   CHECK(armed == 1);
+   CHECK(armedTooth == 6);
+   CHECK_NEAR(armedDelay.raw, TOOTH_TICKS / 3.0, 2);
+}
+
+/*    This is a function used to check the case where a newer plan
+   moves the event back onto a tooth that has already gone by. */
+static void checkMovedEarlier() {
+   start();
+   while (tooth < 4)
+      nextTooth();
+
+   // after tooth 4 it goes on tooth 6
+   plan(angleDegrees(190));
+   nextTooth();
+   CHECK(armed == 0);
+
+   // after tooth 5 it would go on tooth 5, so it goes on tooth 6 from there
+   plan(angleDegrees(170));
+   nextTooth();
+   CHECK(armed == 1);
+   CHECK(armedTooth == 6);
+   CHECK_NEAR(armedDelay.raw, 0, 1);
+
+   // and once it is past the last tooth there is nowhere left to put it
+   while (tooth < TEETH - 1)
+      nextTooth();
+   scheduleClear(&schedule);
+   CHECK(scheduleAdd(&schedule, angleDegrees(350), &observer, arm) == 0);
+}
+
+/*    This is a function used to check a plan that was started before
+   a tooth and published after it. */
+static void checkPublishedLate() {
+   start();
+   while (tooth < 2)
+      nextTooth();
+
+   plan(angleDegrees(140));   // on tooth 4
+   nextTooth();
+
+   // planned after tooth 3 but published after tooth 4 went by
+   scheduleClear(&schedule);
+   observerRun(&observer);
+   scheduleAdd(&schedule, angleDegrees(140), &observer, arm);
+   nextTooth();
+   CHECK(armed == 1);
+   schedulePublish(&schedule);
+
+   // the late plan is dropped rather than armed again or missed
+   nextTooth();
+   nextTooth();
+   CHECK(armed == 1);
+   CHECK(armedTooth == 4);
+}
+
+/*    This is a function used to check the angle the observer gives
+   for times either side of the last tooth, which is at 0 degrees. */
+static void checkAngleAt() {
+   start();
+   CHECK(observerAngleAt(&observer, now) == angleDegrees(0));
+   CHECK(observerAngleAt(&observer, now + ticks_t(TOOTH_TICKS / 4)) == angleDegrees(7.5f));
+   CHECK(observerAngleAt(&observer, now - ticks_t(TOOTH_TICKS / 2)) == angleDegrees(-15));
+   CHECK(observerAngleAt(&observer, now - ticks_t(TOOTH_TICKS)) == angleDegrees(-30));
+}
+
+int main() {
+   int i;
+
+   for (i = 0; i < TEETH; i++) {
+      toothAngles[i] = angleDegrees(30 * i);
+   }
+   checkSteady();
+   checkMovedEarlier();
+   checkPublishedLate();
+   checkAngleAt();
+   return checkReport("scheduler");
+}
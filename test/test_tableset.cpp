@@ -0,0 +1,43 @@
+//test_tableset.cpp
+//Checks that looking tables up as a set gives what looking each one up
+//gives, and leaves every table's cached brackets where its own lookup would,
+//including the tables that reuse another table's axis positions.
+#include <string.h>
+#include "tuning.h"
+#include "check.h"
+
+#define POINTS 20000
+
+table_t *tables[] = {&VETable, &PWTable, &SATable};   // PWTable shares VETable's axes
+tableset_t set = {tables, 3};
+
+/* This is a helper function used to find the bracket an input falls in the slow way. */
+static int bracket(const float *vals, int size, float in) {
+   int i;
+
+   for (i = size - 2; i > 0 && in < vals[i]; i--);
+   return i;
+}
+
+int main() {
+   float results[3], single, x, y;
+   int i, t;
+
+   tableDerive(&PWTable, &dataPW[0][0], &VETable, [](float value, float, float) { return value * 2; });
+
+   for (i = 0; i < POINTS; i++) {
+      // back and forth across both axes and past their ends
+      x = 500 + (i * 37 % 8000);
+      y = 20 + (i * 13 % 90);
+      tableSetLookup(&set, x, y, results);
+      for (t = 0; t < set.count; t++) {
+         if (x < tables[t]->xVals[0])
+            continue;
+         CHECK(tables[t]->xIndex == bracket(tables[t]->xVals, tables[t]->width, x));
+         CHECK(tables[t]->yIndex == bracket(tables[t]->yVals, tables[t]->height, y));
+         single = tableLookup(tables[t], x, y);
+         CHECK(!memcmp(&single, &results[t], sizeof(float)));
+      }
+   }
+   return checkReport("tableset");
+}
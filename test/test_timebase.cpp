@@ -0,0 +1,137 @@
+//test_timebase.cpp
+//Checks that the timebase keeps counting through the tick timer wrapping,
+//from its own interrupts alone, and that captures and compares are put
+//on it right.
+#include "timebase.h"
+#include "check.h"
+
+#define WRAPS 6
+#define STEP 0x0fffff01u
+
+TcChannel *channel = TICK_CHANNEL::channel();
+uint64_t ticks;       // ticks counted since the timebase started
+stamp_t captured;     // time of the last capture, as the handler saw it
+int captures;
+
+/* This is a helper function used to stand in for the ECU's tickISR. */
+static void tickISR(uint32_t status) {
+   if (status & TIMEBASE_STATUS)
+      timebaseNow();
+   if (status & TC_SR_LDRAS) {
+      captured = timebaseCaptured();
+      captures++;
+   }
+}
+
+DUETIMER_STATUS_HANDLER(TICK_TIMER_NUMBER, tickISR)
+
+/*    This is a function used to count the timer on, then take any
+   interrupt it raised latency ticks later, the way the NVIC would. */
+static void run(uint32_t count, uint32_t latency) {
+   tcMockCount(channel, count);
+   ticks += count;
+   if (channel->TC_SR & channel->TC_IMR) {
+      tcMockCount(channel, latency);
+      ticks += latency;
+      TC0_Handler();
+      tcMockStatus(channel);   // the mock does not clear the status when it is read
+   }
+}
+
+/* This is a helper function used to start the timer and the timebase over. */
+static void start() {
+   tcMockReset();
+   timebaseWraps = 0;
+   timebaseLast = 0;
+   ticks = 0;
+   captures = 0;
+   timebaseStart(2, RISING);
+}
+
+/*    This is a function used to leave the timebase alone for several
+   wraps, with only its own interrupts reading it, and each one later
+   than the last so the counter is further on every time it is read. */
+static void checkIdle() {
+   uint32_t latency = 1;
+
+   start();
+   while (ticks < (uint64_t)WRAPS << 32) {
+      run(STEP, latency);
+      latency += 37;
+   }
+   CHECK(timebaseWraps == (uint32_t)(ticks >> 32));
+   CHECK(timebaseNow().raw == (int64_t)ticks);
+}
+
+/*    This is a function used to read the timebase all the time,
+   and check it keeps up with the counter and never goes back. */
+static void checkBusy() {
+   stamp_t now, last;
+
+   start();
+   while (ticks < (uint64_t)3 << 32) {
+      run(0x00ffffffu, 5);
+      now = timebaseNow();
+      CHECK(now.raw == (int64_t)ticks);
+      CHECK(now > last);
+      last = now;
+   }
+}
+
+/*    This is a function used to check captures, with the edge just before
+   a wrap and the handler just after it. */
+static void checkCaptures() {
+   uint64_t edge;
+   uint32_t toWrap;
+   int tooth;
+
+   start();
+   for (tooth = 0; tooth < 3; tooth++) {
+      toWrap = (uint32_t)((((ticks >> 32) + 1) << 32) - ticks);
+      run(toWrap - 20, 3);
+      edge = ticks;
+      tcMockEdge(channel, 1);
+      run(50, 0);
+      CHECK(captures == tooth + 1);
+      CHECK(captured.raw == (int64_t)edge);
+      tcMockEdge(channel, 0);
+   }
+   CHECK(timebaseNow().raw == (int64_t)ticks);
+}
+
+/* This is a helper function used to count a pulse timer on along with the timebase. */
+static void runWith(TcChannel *pulse, uint32_t count) {
+   tcMockCount(pulse, count);
+   run(count, 0);
+}
+
+/*    This is a function used to check that the edges a pulse timer
+   drives on its own compare are put on the timebase right, however late
+   they are read, with the timebase going through a wrap as they go. */
+static void checkCompares() {
+   TcChannel *pulse = DueTimerChannel<7>::channel();
+   uint64_t edge;
+   uint32_t late;
+
+   start();
+   run(0xffffe000u, 3);
+   for (late = 0; late < 3000; late += 250) {
+      Timer7.startPulse(3, 500, 4000);
+      runWith(pulse, 500);
+      edge = ticks;
+      CHECK(tcMockStatus(pulse) & TC_SR_CPAS);
+      runWith(pulse, late);
+      CHECK(timebaseCompared<7>(pulse->TC_RA).raw == (int64_t)edge);
+      runWith(pulse, 4000);
+      CHECK(tcMockStatus(pulse) & TC_SR_CPCS);
+   }
+   CHECK(timebaseWraps == 1);
+}
+
+int main() {
+   checkIdle();
+   checkBusy();
+   checkCaptures();
+   checkCompares();
+   return checkReport("timebase");
+}
@@ -0,0 +1,118 @@
+//test_tuner.cpp
+//Hammers a tuner from one thread while another publishes and looks up,
+//the way tuning over serial and loop() would on the Due, and checks
+//that no lookup ever sees part of one tune and part of another.
+//Each side yields when it has to wait on the other, so it still
+//swaps back and forth often on a single core, and everything else
+//is left to be preempted wherever it happens to be.
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "tuner.h"
+#include "check.h"
+
+#define VERSIONS 8
+#define SECONDS 1
+#define MIN_PUBLISHES 1000
+#define LOOKUPS 16
+
+const float axis[] = {0, 1, 2, 3};
+
+/*  Every tune is the same value all over: the data has it everywhere,
+   and the overlay has it again in the top two rows. A lookup that saw
+   the new data with the old overlay, or half of a staged overlay,
+   would blend two values and not land on a whole tune. */
+float tunes[VERSIONS][4][4];
+
+/* This is a helper function used to give each tune its value. */
+static float tuneValue(unsigned long version) {
+   return (version % VERSIONS) * 10.0f;
+}
+
+/*    This is a function used to stage tunes one after another
+   as fast as the tuner takes them, until told to stop. */
+static void stageTunes(tabletuner_t *tuner, std::atomic<int> *stop) {
+   unsigned long version = 1;
+   int x, y;
+
+   while (!stop->load()) {
+      if (!tunerBegin(tuner)) {
+         std::this_thread::yield();
+         continue;
+      }
+      tunerReplace(tuner, tunes[version % VERSIONS]);
+      for (y = 0; y < 2; y++) {
+         for (x = 0; x < 4; x++) {
+            tunerSet(tuner, x, y, tuneValue(version));
+         }
+      }
+      tunerCommit(tuner);
+      version++;
+   }
+}
+
+/*    This is a function used to act as loop(): publish at the start of
+   each cycle, then look the table up all over and check it is whole. */
+static void hammer(table_t *table, const char *what) {
+   tabletuner_t tuner;
+   std::atomic<int> stop(0);
+   unsigned long published = 0;
+   unsigned long lookups = 0;
+   unsigned long torn = 0;
+   unsigned long skipped = 0;
+   float expected = 0, value;
+   unsigned int seed = 1;
+   int i;
+   std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::seconds(SECONDS);
+
+   tunerInit(&tuner, table);
+   std::thread tuning(stageTunes, &tuner, &stop);
+
+   while (std::chrono::steady_clock::now() < end) {
+      if (tunerPublish(&tuner)) {
+         published++;
+         expected = tuneValue(published);
+      } else {
+         std::this_thread::yield();
+      }
+      for (i = 0; i < LOOKUPS; i++) {
+         seed = seed * 1103515245 + 12345;
+         value = tableLookup(table, (seed >> 8) % 3000 * 0.001f, (seed >> 20) % 3000 * 0.001f);
+         lookups++;
+         if (value != expected)
+            torn++;
+      }
+      if (tuner.version != published)
+         skipped++;
+   }
+
+   stop.store(1);
+   tuning.join();
+
+   printf("%s: %lu publishes, %lu lookups, %lu torn\n", what, published, lookups, torn);
+   CHECK(torn == 0);
+   CHECK(skipped == 0);
+   CHECK(published >= MIN_PUBLISHES);
+}
+
+int main() {
+   int v, x, y;
+
+   for (v = 0; v < VERSIONS; v++) {
+      for (y = 0; y < 4; y++) {
+         for (x = 0; x < 4; x++) {
+            tunes[v][y][x] = tuneValue(v);
+         }
+      }
+   }
+
+   Table<4, 4> plain(axis, axis, tunes[0], -1);
+   hammer(&plain, "blended from data");
+
+   static tablecoef_t coefs[3 * 3];
+   Table<4, 4> fast(axis, axis, tunes[0], -1);
+   tableUseCoefs(&fast, coefs);
+   hammer(&fast, "blended from cell coefficients");
+
+   return checkReport("tuner");
+}
@@ -0,0 +1,54 @@
+//test_uniformtable.cpp
+//Checks a UniformTable resampled from VETable against VETable itself.
+#include "uniformtable.h"
+#include "tuning.h"
+#include "check.h"
+
+UniformTable<14, 15, 1000, 500, 30, 5> uniformVE;
+
+int main() {
+   int x, y;
+   float rpm, map;
+
+   uniformVE.resample(&VETable);
+
+   // on the grid points it is the table
+   for (y = 30; y <= 100; y += 5) {
+      for (x = 1000; x <= 7500; x += 500) {
+         CHECK_NEAR(uniformVE.lookup(x, y), tableLookup(&VETable, x, y), 1e-4f);
+      }
+   }
+
+   // past the ends it clamps, the same as the table
+   for (map = 0; map <= 130; map += 2.5f) {
+      CHECK_NEAR(uniformVE.lookup(9000, map), uniformVE.lookup(7500, map < 30 ? 30 : map > 100 ? 100 : map), 1e-4f);
+   }
+   for (y = 0; y <= 130; y += 5) {
+      CHECK_NEAR(uniformVE.lookup(8000, y), tableLookup(&VETable, 8000, y < 30 ? 30 : y), 1e-4f);
+   }
+   for (rpm = 1000; rpm <= 9000; rpm += 250) {
+      CHECK_NEAR(uniformVE.lookup(rpm, 20), uniformVE.lookup(rpm, 30), 1e-4f);
+      CHECK_NEAR(uniformVE.lookup(rpm, 150), uniformVE.lookup(rpm, 100), 1e-4f);
+   }
+   CHECK_NEAR(uniformVE.lookup(8000, 50), tableLookup(&VETable, 8000, 50), 1e-4f);
+   CHECK_NEAR(uniformVE.lookup(2000, 20), tableLookup(&VETable, 2000, 20), 1e-4f);
+
+   // and below the x axis it gives the default
+   CHECK(uniformVE.lookup(500, 50) == VETable.defaultVal);
+
+   // in between it stays inside the four points around it
+   for (map = 30; map <= 100; map += 1.3f) {
+      for (rpm = 1000; rpm <= 7500; rpm += 37) {
+         x = (int)((rpm - 1000) / 500) * 500 + 1000;
+         y = (int)((map - 30) / 5) * 5 + 30;
+         if (x == 7500) x -= 500;
+         if (y == 100) y -= 5;
+         CHECK(uniformVE.lookup(rpm, map) >= fminf(fminf(uniformVE.lookup(x, y), uniformVE.lookup(x + 500, y)),
+                                                   fminf(uniformVE.lookup(x, y + 5), uniformVE.lookup(x + 500, y + 5))) - 1e-4f);
+         CHECK(uniformVE.lookup(rpm, map) <= fmaxf(fmaxf(uniformVE.lookup(x, y), uniformVE.lookup(x + 500, y)),
+                                                   fmaxf(uniformVE.lookup(x, y + 5), uniformVE.lookup(x + 500, y + 5))) + 1e-4f);
+      }
+   }
+
+   return checkReport("uniformtable");
+}
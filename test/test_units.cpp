@@ -0,0 +1,107 @@
+//test_units.cpp
+//Checks the fixed point angle, time and speed types in units.h
+//against the float math the ECU used before them, from 300 to 9000 rpm.
+#include "units.h"
+#include "check.h"
+
+#define TOOTH_DEGREES 30.0f
+#define DWELL_US 3500.0f
+
+/*  The old math kept engine speed in degrees per microsecond,
+   which it called DPMS, worked out from three revolutions. */
+static float oldSpeed(float revWindowUs) {
+   return 360.0f * 3.0f / revWindowUs;
+}
+
+static float oldRpm(float dpms) {
+   return dpms * 166667;
+}
+
+/*    This is a function used to check that angles go to 1/64 degree and back. */
+static void checkAngles() {
+   float degrees;
+
+   for (degrees = -720; degrees <= 720; degrees += 0.37f) {
+      CHECK_NEAR(angleToDegrees(angleDegrees(degrees)), degrees, 0.5f / ANGLE_ONE + 1e-4f);
+   }
+   CHECK(angleDegrees(360) == angle_t(360 * ANGLE_ONE));
+   CHECK(angleDegrees(-0.25f) == angle_t(-16));
+}
+
+/*    This is a function used to check that time in ticks goes to microseconds and back.
+   Going back rounds down to a whole microsecond, for printing,
+   and MICROS_PER_TICK being rounded to Q16 adds up to 4 ppm. */
+static void checkTimes() {
+   float us;
+
+   for (us = 0; us < 1000000; us += 9.73f) {
+      CHECK_NEAR(ticksToMicros(ticksMicros(us)), us - 0.5f, 1.0f + us * 4e-6f);
+   }
+
+   // differences stay right across the counter wrapping
+   CHECK(ticks_t(INT32_MAX) + ticks_t(10) - ticks_t(INT32_MAX) == ticks_t(10));
+   CHECK(ticks_t(INT32_MIN + 5) - ticks_t(INT32_MAX) == ticks_t(6));
+}
+
+/*    This is a function used to check the speed conversions against the old
+   float math, at every 10 rpm from 300 to 9000. */
+static void checkSpeeds() {
+   int rpm;
+   float revWindowUs, toothUs, dpms, usPerDegree;
+   ticks_t revWindow, toothPeriod, duration;
+   speed_t engineSpeed, toothSpeed;
+   angle_t angle;
+   float degrees, us;
+
+   for (rpm = 300; rpm <= 9000; rpm += 10) {
+      // time the same revolutions and teeth both ways, rounded to a tick
+      revWindow = ticksMicros(3 * 60e6f / rpm);
+      revWindowUs = revWindow.raw * (1e6f / TICKS_PER_SECOND);
+      toothPeriod = ticksMicros(60e6f / rpm / 12);
+      toothUs = toothPeriod.raw * (1e6f / TICKS_PER_SECOND);
+      dpms = oldSpeed(revWindowUs);
+
+      // engine speed for the tables
+      engineSpeed = speedFrom(angleDegrees(1080), revWindow);
+      CHECK_NEAR(speedToRpm(engineSpeed), oldRpm(dpms), oldRpm(dpms) * 1e-5f);
+
+      // angle the crank turns in the dwell and in a fuel pulse
+      CHECK_NEAR(angleToDegrees(ticksToAngle(ticksMicros(DWELL_US), engineSpeed)),
+                 ticksMicros(DWELL_US).raw * (1e6f / TICKS_PER_SECOND) * dpms, 1.0f / ANGLE_ONE + 1e-3f);
+      for (us = 500; us <= 20000; us += 1500) {
+         duration = ticksMicros(us);
+         CHECK_NEAR(angleToDegrees(ticksToAngle(duration, engineSpeed)),
+                    duration.raw * (1e6f / TICKS_PER_SECOND) * dpms, 1.0f / ANGLE_ONE + 1e-3f);
+      }
+
+      // delay from a tooth to an event, scaled by the last tooth period
+      toothSpeed = speedFrom(angleDegrees(30), toothPeriod);
+      usPerDegree = toothUs / TOOTH_DEGREES;
+      for (degrees = 0; degrees <= 60; degrees += 1.75f) {
+         angle = angleDegrees(degrees);
+         CHECK_NEAR(ticksToMicros(angleToTicks(angle, toothSpeed)), angleToDegrees(angle) * usPerDegree, 1.5f);
+      }
+
+      // and back again, to within the angle of half a tick
+      CHECK_NEAR(angleToDegrees(ticksToAngle(angleToTicks(angleDegrees(45), toothSpeed), toothSpeed)), 45,
+                 1.0f / ANGLE_ONE + angleToDegrees(ticksToAngle(ticks_t(1), toothSpeed)) / 2);
+   }
+}
+
+/*    This is a function used to check what happens at the edges. */
+static void checkLimits() {
+   CHECK(speedFrom(angleDegrees(360), ticks_t(0)) == speed_t(0));
+   CHECK(speedFrom(angleDegrees(360), ticks_t(-5)) == speed_t(0));
+   CHECK(angleToTicks(angleDegrees(30), speed_t(0)) == ticks_t(INT32_MAX));
+   CHECK(ticksToAngle(ticks_t(INT32_MAX), speed_t(INT32_MAX)) == angle_t(INT32_MAX));
+   CHECK(angleToTicks(angleDegrees(30000), speed_t(1)) == ticks_t(INT32_MAX));
+   CHECK(unitClamp((int64_t)INT32_MIN - 1) == INT32_MIN);
+}
+
+int main() {
+   checkAngles();
+   checkTimes();
+   checkSpeeds();
+   checkLimits();
+   return checkReport("units");
+}